@@ -0,0 +1,92 @@
+/*
+
+Benchmark the face union fallback (unionMeshFacesToNef) with and without
+grouping adjacent coplanar faces into polygons first.
+
+Besides the objects.h fixtures, this uses a unit cube with every side
+tessellated into an n x n grid, which is what CAD exports tend to look like.
+
+Usage: bench_coplanar [n] [repetitions]
+
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+#include <CGAL/Real_timer.h>
+
+#include "cgal_tools.h"
+#include "objects.h"
+
+// Unit cube, each side split into n x n quads of two triangles. Every side
+// has its own vertices, like a typical per-face tessellated export.
+Object tessellatedCube(int n) {
+  struct Side {
+    DoubleVertex origin, u, v; // u x v points outwards
+  };
+  const Side sides[] = {
+      {{0, 0, 0}, {0, 1, 0}, {1, 0, 0}}, {{0, 0, 1}, {1, 0, 0}, {0, 1, 0}},
+      {{0, 0, 0}, {1, 0, 0}, {0, 0, 1}}, {{0, 1, 0}, {0, 0, 1}, {1, 0, 0}},
+      {{0, 0, 0}, {0, 0, 1}, {0, 1, 0}}, {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}},
+  };
+
+  Object obj;
+  for (const auto &side : sides) {
+    const uint32_t base = obj.vertices.size();
+    for (int j = 0; j <= n; ++j) {
+      for (int i = 0; i <= n; ++i) {
+        DoubleVertex p;
+        for (int k = 0; k < 3; ++k) {
+          p[k] = side.origin[k] + side.u[k] * i / n + side.v[k] * j / n;
+        }
+        obj.vertices.push_back(p);
+      }
+    }
+    for (int j = 0; j < n; ++j) {
+      for (int i = 0; i < n; ++i) {
+        const uint32_t p00 = base + j * (n + 1) + i;
+        const uint32_t p10 = p00 + 1;
+        const uint32_t p01 = p00 + n + 1;
+        const uint32_t p11 = p01 + 1;
+        obj.indices.push_back({p00, p10, p11});
+        obj.indices.push_back({p00, p11, p01});
+      }
+    }
+  }
+  return obj;
+}
+
+void benchmark(const std::string &name, const Object &obj, int repetitions) {
+  SurfaceMesh mesh = createSurfaceMesh(obj);
+  std::cout << "== " << name << " (" << mesh.number_of_faces() << " faces) =="
+            << std::endl;
+
+  CGAL_Nef_polyhedron3 results[2];
+  double times_ms[2];
+  for (bool group_coplanar : {false, true}) {
+    const size_t operands = collectFacetPolygons(mesh, group_coplanar).size();
+    CGAL::Real_timer t;
+    t.start();
+    for (int r = 0; r < repetitions; ++r) {
+      results[group_coplanar] = unionMeshFacesToNef(mesh, group_coplanar);
+    }
+    t.stop();
+    times_ms[group_coplanar] = t.time() * 1000 / repetitions;
+    std::cout << "  " << (group_coplanar ? "grouped:  " : "per face: ")
+              << operands << " operands, " << times_ms[group_coplanar]
+              << " ms" << std::endl;
+  }
+  std::cout << "  speedup " << times_ms[0] / times_ms[1]
+            << "x, same result: " << (results[0] == results[1]) << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+  const int n = argc > 1 ? std::max(1, std::stoi(argv[1])) : 8;
+  const int repetitions = argc > 2 ? std::max(1, std::stoi(argv[2])) : 3;
+  benchmark("touching_cubes", touching_cubes, repetitions);
+  benchmark("tetracyl", tetracyl, repetitions);
+  benchmark("tessellated cube " + std::to_string(n) + "x" + std::to_string(n),
+            tessellatedCube(n), repetitions);
+  return 0;
+}
@@ -0,0 +1,132 @@
+/*
+
+Benchmark the part extraction strategies of decompose_to_sink(): through
+Polyhedron_3, through the shell exploration visitor, and the automatic choice
+per part by its size (shell_exploration_min_vertices). Only the "extraction"
+stage is timed, the convex decomposition itself is the same for all three.
+
+Then both strategies are timed on every part, grouped by part size in powers
+of two, and the smallest size from which shell exploration is faster (for
+that and all larger sizes) is printed as the suggested
+shell_exploration_min_vertices.
+
+Runs on the fixtures from objects.h, and on a Nef file if one is given.
+
+Usage: bench_extraction [repetitions] [file.nef3]
+
+ */
+
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <map>
+#include <string>
+
+#include <CGAL/Real_timer.h>
+
+#include "cgal_tools.h"
+#include "objects.h"
+
+void benchmark(const std::string &name, const CGAL_Nef_polyhedron3 &nef,
+               int repetitions) {
+  std::cout << "== " << name << " (" << nef.number_of_vertices()
+            << " vertices) ==" << std::endl;
+  const std::pair<PartExtraction, const char *> strategies[] = {
+      {PartExtraction::Polyhedron, "polyhedron: "},
+      {PartExtraction::ShellExploration, "visitor:    "},
+      {PartExtraction::Automatic, "automatic:  "},
+  };
+  for (const auto &[extraction, label] : strategies) {
+    PipelineMetrics metrics;
+    current_metrics = &metrics;
+    size_t num_parts = 0, num_points = 0;
+    for (int r = 0; r < repetitions; ++r) {
+      num_parts = num_points = 0;
+      // Decomposes a copy, so nef stays intact for the next round.
+      decompose_to_sink(
+          CGAL_Nef_polyhedron3(nef),
+          [&](std::vector<Double_Point3> &&part) {
+            num_parts++;
+            num_points += part.size();
+          },
+          extraction);
+    }
+    current_metrics = nullptr;
+
+    double extraction_ms = 0;
+    for (const auto &stage : metrics.stages()) {
+      if (stage.name == "extraction") extraction_ms += stage.wall_ms;
+    }
+    std::cout << "  " << label << extraction_ms / repetitions << " ms, "
+              << num_parts << " parts, " << num_points << " points"
+              << std::endl;
+  }
+}
+
+// Returns the suggested threshold, or 0 if Polyhedron_3 is never slower.
+size_t timePerPartSize(const CGAL_Nef_polyhedron3 &nef, int repetitions) {
+  CGAL_Nef_polyhedron3 decomposed(nef);
+  CGAL::convex_decomposition_3(decomposed);
+  const auto sizes = volumeSizes(decomposed);
+
+  // Part size bucket -> total ms via Polyhedron_3, via exploration, parts.
+  std::map<size_t, std::array<double, 3>> buckets;
+  for (auto ci = decomposed.volumes_begin(); ci != decomposed.volumes_end();
+       ++ci) {
+    if (!ci->mark()) continue;
+    size_t bucket = 1;
+    while (bucket * 2 <= sizes.at(&*ci)) bucket *= 2;
+    auto &b = buckets[bucket];
+    for (int exploration = 0; exploration < 2; ++exploration) {
+      CGAL::Real_timer t;
+      t.start();
+      for (int r = 0; r < repetitions; ++r) {
+        extractPart(decomposed, ci, exploration == 1);
+      }
+      t.stop();
+      b[exploration] += t.time() * 1000 / repetitions;
+    }
+    b[2]++;
+  }
+
+  for (const auto &[bucket, b] : buckets) {
+    std::cout << "  parts of " << bucket << "-" << 2 * bucket - 1
+              << " vertices (" << b[2] << "): polyhedron " << b[0] / b[2]
+              << " ms, visitor " << b[1] / b[2] << " ms per part"
+              << std::endl;
+  }
+  size_t suggested = 0;
+  for (auto it = buckets.rbegin(); it != buckets.rend(); ++it) {
+    if (it->second[1] >= it->second[0]) break;
+    suggested = it->first;
+  }
+  return suggested;
+}
+
+void run(const std::string &name, const CGAL_Nef_polyhedron3 &nef,
+         int repetitions) {
+  benchmark(name, nef, repetitions);
+  const size_t suggested = timePerPartSize(nef, repetitions);
+  if (suggested > 0) {
+    std::cout << "  suggested shell_exploration_min_vertices: " << suggested
+              << std::endl;
+  } else {
+    std::cout << "  Polyhedron_3 is not slower for any part size" << std::endl;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  const int repetitions = argc > 1 ? std::max(1, std::stoi(argv[1])) : 10;
+  std::cout << "shell_exploration_min_vertices: "
+            << shell_exploration_min_vertices << std::endl;
+  run("touching_cubes", convertSurfaceMeshToNef(createSurfaceMesh(touching_cubes)),
+      repetitions);
+  run("tetracyl", convertSurfaceMeshToNef(createSurfaceMesh(tetracyl)),
+      repetitions);
+  if (argc > 2) {
+    CGAL_Nef_polyhedron3 nef;
+    readNef(argv[2], nef);
+    run(argv[2], nef, repetitions);
+  }
+  return 0;
+}
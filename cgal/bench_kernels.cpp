@@ -0,0 +1,64 @@
+/*
+
+Run the Nef pipeline (mesh -> Nef -> convex decomposition -> hulls) on the
+fixtures from objects.h and report wall time and peak RSS.
+
+The kernel is fixed at compile time via CGAL_TOOLS_KERNEL, and the benchmark
+is built once per kernel (bench_kernels_gmpq, bench_kernels_epeck,
+bench_kernels_lazy), since peak RSS is a per-process number.
+
+With --gmp-alloc, GMP allocations go through the pooled gmp_allocator, and
+its totals are printed at the end.
+
+Usage: bench_kernels [--gmp-alloc] [repetitions]
+
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+#include <CGAL/Real_timer.h>
+
+#include "cgal_tools.h"
+#include "objects.h"
+
+void benchmark(const std::string &name, const Object &obj, int repetitions) {
+  CGAL::Real_timer t;
+  size_t num_parts = 0;
+  t.start();
+  for (int r = 0; r < repetitions; ++r) {
+    SurfaceMesh mesh = createSurfaceMesh(obj);
+    CGAL_Nef_polyhedron3 nef = convertSurfaceMeshToNef(mesh);
+    auto parts = decompose(std::move(nef));
+    auto meshes = hull_parts(parts);
+    num_parts = meshes.size();
+  }
+  t.stop();
+  std::cerr << "== " << name << ": " << t.time() * 1000 / repetitions
+            << " ms, " << num_parts << " parts, peak RSS " << peakRSS()
+            << " MiB" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+  int repetitions = 10;
+  bool gmp_alloc = false;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--gmp-alloc") {
+      gmp_alloc = true;
+    } else {
+      repetitions = std::max(1, std::stoi(arg));
+    }
+  }
+  if (gmp_alloc) gmp_allocator::install();
+  std::cerr << "Kernel: " << CGAL_Kernel3_name
+            << (gmp_alloc ? ", pooled GMP allocator" : "") << std::endl;
+  benchmark("first_cube", first_cube, repetitions);
+  benchmark("separate_cubes", separate_cubes, repetitions);
+  benchmark("touching_cubes", touching_cubes, repetitions);
+  benchmark("touching_cubes_14", touching_cubes_14, repetitions);
+  benchmark("tetracyl", tetracyl, repetitions);
+  if (gmp_alloc) gmp_allocator::printStats(std::cerr);
+  return 0;
+}
@@ -0,0 +1,72 @@
+/*
+
+Compare peak RSS of decomposing a Nef read from file (by default
+data/issue1455.nef3) and hulling its parts, when the pipeline
+- decomposes a copy and keeps the original (copy),
+- decomposes in place and keeps the decomposed Nef (in place),
+- hands the Nef over to decompose() (consuming).
+
+Every mode runs in its own child process, so the reported peak RSS belongs
+to that mode alone.
+
+Usage: bench_memory [file.nef3]
+
+ */
+
+#include <iostream>
+#include <string>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <CGAL/Real_timer.h>
+
+#include "cgal_tools.h"
+
+enum class Mode { Copy, InPlace, Consuming };
+
+void run(const std::string &filename, Mode mode) {
+  CGAL_Nef_polyhedron3 nef;
+  readNef(filename, nef);
+  const double read_rss = peakRSS();
+
+  CGAL::Real_timer t;
+  t.start();
+  std::vector<std::vector<Double_Point3>> parts;
+  switch (mode) {
+  case Mode::Copy:
+    parts = decompose(CGAL_Nef_polyhedron3(nef));
+    break;
+  case Mode::InPlace:
+    parts = decompose(nef);
+    break;
+  case Mode::Consuming:
+    parts = decompose(std::move(nef));
+    break;
+  }
+  auto meshes = hull_parts(parts);
+  t.stop();
+
+  const char *names[] = {"copy", "in place", "consuming"};
+  std::cerr << "== " << names[static_cast<int>(mode)] << ": "
+            << t.time() * 1000 << " ms, " << meshes.size()
+            << " parts, peak RSS " << read_rss << " MiB after reading, "
+            << peakRSS() << " MiB total" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+  const std::string filename = argc > 1 ? argv[1] : "data/issue1455.nef3";
+  for (Mode mode : {Mode::Copy, Mode::InPlace, Mode::Consuming}) {
+    std::cout.flush();
+    const pid_t pid = fork();
+    if (pid == 0) {
+      run(filename, mode);
+      std::cout.flush();
+      std::cerr.flush();
+      _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+  }
+  return 0;
+}
@@ -0,0 +1,61 @@
+/*
+
+Compare the monolithic convex decomposition (decompose()) with the slab
+partitioned one (decomposeBySlabs()) at 2, 4 and 8 slabs: wall time and part
+count, before and after merging parts across slab boundaries.
+
+Runs on the fixtures from objects.h, and on a Nef file if one is given.
+
+Usage: bench_slabs [threads] [file.nef3]
+
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <CGAL/Real_timer.h>
+
+#include "cgal_tools.h"
+#include "objects.h"
+
+void benchmark(const std::string &name, const CGAL_Nef_polyhedron3 &nef,
+               ThreadPool &pool) {
+  std::cout << "== " << name << " (" << nef.number_of_vertices()
+            << " vertices) ==" << std::endl;
+  double monolithic_ms = 0;
+  for (size_t num_slabs : {1, 2, 4, 8}) {
+    CGAL::Real_timer t;
+    t.start();
+    auto parts = num_slabs == 1 ? decompose(CGAL_Nef_polyhedron3(nef))
+                                : decomposeBySlabs(nef, num_slabs, pool);
+    t.stop();
+    const double ms = t.time() * 1000;
+    if (num_slabs == 1) monolithic_ms = ms;
+    PartMergeStats merge_stats;
+    mergeConvexParts(std::move(parts), &merge_stats);
+    std::cout << "  " << num_slabs << " slab(s): " << ms << " ms (speedup "
+              << monolithic_ms / ms << "x), " << merge_stats.parts_before
+              << " parts, " << merge_stats.parts_after << " after merging"
+              << std::endl;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  const unsigned int num_threads =
+      argc > 1 ? std::max(1, std::stoi(argv[1]))
+               : std::thread::hardware_concurrency();
+  ThreadPool pool(num_threads);
+  std::cout << "Threads: " << pool.size() << std::endl;
+  benchmark("touching_cubes",
+            convertSurfaceMeshToNef(createSurfaceMesh(touching_cubes)), pool);
+  benchmark("tetracyl", convertSurfaceMeshToNef(createSurfaceMesh(tetracyl)),
+            pool);
+  if (argc > 2) {
+    CGAL_Nef_polyhedron3 nef;
+    readNef(argv[2], nef);
+    benchmark(argv[2], nef, pool);
+  }
+  return 0;
+}
@@ -0,0 +1,86 @@
+/*
+
+Compare the Nef pipeline (mesh -> Nef -> convex decomposition -> hulls) on
+the raw input with Cartesian<Gmpq> against input snapped to a power of two
+grid with Homogeneous<Gmpz>, on data/cubes.stl and on fixtures from objects.h
+scaled by non-dyadic factors.
+
+Every run happens in its own child process, so the reported peak RSS belongs
+to that run alone.
+
+Usage: bench_snapping [grid_bits] [data/cubes.stl]
+
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <CGAL/Real_timer.h>
+
+#include "cgal_tools.h"
+#include "objects.h"
+
+Object scaled(const Object &obj, double factor) {
+  Object result = obj;
+  for (auto &v : result.vertices) {
+    for (auto &c : v) c *= factor;
+  }
+  return result;
+}
+
+template <typename Kernel>
+void runPipeline(const std::string &name, const std::string &mode,
+                 const Object &obj) {
+  CGAL::Real_timer t;
+  t.start();
+  auto mesh = createSurfaceMesh<Kernel>(obj);
+  auto nef = convertSurfaceMeshToNef(mesh);
+  auto parts = decompose(std::move(nef));
+  auto meshes = hull_parts(parts);
+  t.stop();
+  std::cerr << "== " << name << ", " << mode << ": " << t.time() * 1000
+            << " ms, " << meshes.size() << " parts, peak RSS " << peakRSS()
+            << " MiB" << std::endl;
+}
+
+// Runs fn in a child process and waits for it.
+template <typename Fn> void inChild(Fn fn) {
+  std::cout.flush();
+  const pid_t pid = fork();
+  if (pid == 0) {
+    fn();
+    std::cout.flush();
+    std::cerr.flush();
+    _exit(0);
+  }
+  int status = 0;
+  waitpid(pid, &status, 0);
+}
+
+void benchmark(const std::string &name, const Object &obj, int grid_bits) {
+  inChild([&] { runPipeline<CGAL::Cartesian<CGAL::Gmpq>>(name, "Cartesian<Gmpq>", obj); });
+  inChild([&] {
+    size_t num_merged = 0;
+    const Object snapped = snapToGrid(obj, grid_bits, num_merged);
+    runPipeline<CGAL::Homogeneous<CGAL::Gmpz>>(
+        name,
+        "snapped to 2^-" + std::to_string(grid_bits) + " (" +
+            std::to_string(num_merged) + " merged), Homogeneous<Gmpz>",
+        snapped);
+  });
+}
+
+int main(int argc, char *argv[]) {
+  const int grid_bits = argc > 1 ? std::max(0, std::stoi(argv[1])) : 16;
+  const std::string stl = argc > 2 ? argv[2] : "data/cubes.stl";
+  benchmark("cubes.stl", readSTL(stl), grid_bits);
+  benchmark("touching_cubes x 0.1", scaled(touching_cubes, 0.1), grid_bits);
+  benchmark("tetracyl x 333.3", scaled(tetracyl, 333.3), grid_bits);
+  benchmark("separate_cubes x 1000/3", scaled(separate_cubes, 1000.0 / 3),
+            grid_bits);
+  return 0;
+}
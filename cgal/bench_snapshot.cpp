@@ -0,0 +1,49 @@
+/*
+
+Freeze Nef polyhedra into NefSnapshots and thaw them again: prints the
+memory per element of the live SNC and of the snapshot, the freeze and thaw
+times, and whether the thawed Nef equals the original.
+
+Runs on the fixtures from objects.h, and on Nef files if given.
+
+Usage: bench_snapshot [file.nef3 ...]
+
+ */
+
+#include <iostream>
+#include <string>
+
+#include <CGAL/Real_timer.h>
+
+#include "cgal_tools.h"
+#include "nef_snapshot.h"
+#include "objects.h"
+
+void benchmark(const std::string &name, const CGAL_Nef_polyhedron3 &nef) {
+  std::cout << "== " << name << " ==" << std::endl;
+  CGAL::Real_timer freeze_timer, thaw_timer;
+  freeze_timer.start();
+  const NefSnapshot<CGAL_Nef_polyhedron3> snapshot(nef);
+  freeze_timer.stop();
+  thaw_timer.start();
+  const CGAL_Nef_polyhedron3 thawed = snapshot.thaw();
+  thaw_timer.stop();
+
+  snapshot.printMemory(std::cout);
+  std::cout << "freeze: " << freeze_timer.time() * 1000 << " ms, thaw: "
+            << thaw_timer.time() * 1000 << " ms, "
+            << (thawed.is_valid() && thawed == nef ? "same" : "DIFFERENT")
+            << " after thawing" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+  benchmark("touching_cubes",
+            convertSurfaceMeshToNef(createSurfaceMesh(touching_cubes)));
+  benchmark("tetracyl", convertSurfaceMeshToNef(createSurfaceMesh(tetracyl)));
+  for (int i = 1; i < argc; ++i) {
+    CGAL_Nef_polyhedron3 nef;
+    readNef(argv[i], nef);
+    benchmark(argv[i], nef);
+  }
+  return 0;
+}
@@ -0,0 +1,85 @@
+/*
+
+Compare building a Nef from a triangle soup directly (buildNefFromSoup()) with
+the Surface_mesh path: convertSurfaceMeshToNef() for closed soups, and the
+face union (unionMeshFacesToNef()) for open ones. Prints both times and
+whether the results are the same point set. Both paths are timed with
+std::cout silenced, so the progress lines of the mesh path don't count
+against it; neither path writes files.
+
+Runs on the fixtures from objects.h, on an open box, and on an STL file if
+one is given.
+
+Usage: bench_soup [repetitions] [file.stl]
+
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+#include <CGAL/Real_timer.h>
+
+#include "cgal_tools.h"
+#include "objects.h"
+
+// Discards everything written to std::cout while it lives.
+class SilenceCout {
+public:
+  SilenceCout() : saved_(std::cout.rdbuf(nullptr)) {}
+  ~SilenceCout() {
+    std::cout.rdbuf(saved_);
+    std::cout.clear();
+  }
+
+private:
+  std::streambuf *saved_;
+};
+
+void benchmark(const std::string &name, const Object &obj, int repetitions) {
+  std::cout << "== " << name << " (" << obj.indices.size() << " faces) =="
+            << std::endl;
+  ManifoldStats stats;
+  splitNonManifold(obj, &stats);
+
+  CGAL::Real_timer mesh_timer, soup_timer;
+  CGAL_Nef_polyhedron3 mesh_nef;
+  std::optional<CGAL_Nef_polyhedron3> soup_nef;
+  for (int r = 0; r < repetitions; ++r) {
+    SilenceCout silence;
+    mesh_timer.start();
+    SurfaceMesh mesh = createSurfaceMesh(obj);
+    mesh_nef = stats.closed ? convertSurfaceMeshToNef(mesh)
+                            : unionMeshFacesToNef(mesh);
+    mesh_timer.stop();
+
+    soup_timer.start();
+    soup_nef = buildNefFromSoup(obj);
+    soup_timer.stop();
+  }
+  std::cout << "  " << (stats.closed ? "mesh:       " : "face union: ")
+            << mesh_timer.time() * 1000 / repetitions << " ms" << std::endl;
+  if (!soup_nef) {
+    std::cout << "  soup:       not directly buildable" << std::endl;
+    return;
+  }
+  std::cout << "  soup:       " << soup_timer.time() * 1000 / repetitions
+            << " ms (speedup " << mesh_timer.time() / soup_timer.time()
+            << "x), " << (*soup_nef == mesh_nef ? "same" : "DIFFERENT")
+            << " result" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+  const int repetitions = argc > 1 ? std::max(1, std::stoi(argv[1])) : 10;
+
+  // Unit cube without its top: an open shell, kept as a surface.
+  Object open_box = boxObject({0, 0, 0}, {1, 1, 1});
+  open_box.indices.erase(open_box.indices.begin() + 2,
+                         open_box.indices.begin() + 4);
+
+  benchmark("separate_cubes", separate_cubes, repetitions);
+  benchmark("tetracyl", tetracyl, repetitions);
+  benchmark("open_box", open_box, repetitions);
+  if (argc > 2) benchmark(argv[2], readSTL(argv[2]), repetitions);
+  return 0;
+}
@@ -0,0 +1,116 @@
+/*
+
+Benchmark the face union fallback (unionMeshFacesToNef) sequentially and
+with the parallel tree reduction at 1/2/4/8 threads, once with one operand
+per facet and once with coplanar facets grouped (the default).
+
+Also compare unionNefs() with plain += on a grid of separate cubes, where the
+bounding box clustering can skip all overlays.
+
+Usage: bench_union [repetitions]
+
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <CGAL/Real_timer.h>
+
+#include "cgal_tools.h"
+#include "objects.h"
+
+void benchmark(const std::string &name, const Object &obj, int repetitions,
+               bool group_coplanar) {
+  std::cout << "== " << name << " (" << obj.indices.size() << " facets, "
+            << (group_coplanar ? "coplanar facets grouped" : "per facet")
+            << ") ==" << std::endl;
+  SurfaceMesh mesh = createSurfaceMesh(obj);
+
+  CGAL::Real_timer t;
+  CGAL_Nef_polyhedron3 sequential;
+  t.start();
+  for (int r = 0; r < repetitions; ++r) {
+    sequential = unionMeshFacesToNef(mesh, group_coplanar);
+  }
+  t.stop();
+  const double sequential_ms = t.time() * 1000 / repetitions;
+  std::cout << "  sequential: " << sequential_ms << " ms" << std::endl;
+
+  for (unsigned int num_threads : {1, 2, 4, 8}) {
+    ThreadPool pool(num_threads);
+    CGAL_Nef_polyhedron3 parallel;
+    t.reset();
+    t.start();
+    for (int r = 0; r < repetitions; ++r) {
+      parallel = unionMeshFacesToNef(mesh, pool, group_coplanar);
+    }
+    t.stop();
+    const double parallel_ms = t.time() * 1000 / repetitions;
+    std::cout << "  parallel, " << num_threads << " threads: " << parallel_ms
+              << " ms (speedup " << sequential_ms / parallel_ms
+              << "x, same result: " << (parallel == sequential) << ")"
+              << std::endl;
+  }
+}
+
+// n x n x n unit cubes with a gap of one unit between neighbours.
+std::vector<CGAL_Nef_polyhedron3> separateCubeNefs(int n) {
+  std::vector<CGAL_Nef_polyhedron3> nefs;
+  for (int x = 0; x < n; ++x) {
+    for (int y = 0; y < n; ++y) {
+      for (int z = 0; z < n; ++z) {
+        Object cube = first_cube;
+        for (auto &v : cube.vertices) {
+          v[0] += 2 * x;
+          v[1] += 2 * y;
+          v[2] += 2 * z;
+        }
+        nefs.emplace_back(createSurfaceMesh(cube));
+      }
+    }
+  }
+  return nefs;
+}
+
+void benchmarkDisjoint(int n, int repetitions) {
+  const auto nefs = separateCubeNefs(n);
+  std::cout << "== " << nefs.size() << " separate cubes ==" << std::endl;
+
+  CGAL::Real_timer t;
+  CGAL_Nef_polyhedron3 sum;
+  t.start();
+  for (int r = 0; r < repetitions; ++r) {
+    sum = CGAL_Nef_polyhedron3();
+    for (const auto &nef : nefs) sum += nef;
+  }
+  t.stop();
+  const double plain_ms = t.time() * 1000 / repetitions;
+  std::cout << "  +=: " << plain_ms << " ms" << std::endl;
+
+  UnionStats stats;
+  CGAL_Nef_polyhedron3 clustered;
+  t.reset();
+  t.start();
+  for (int r = 0; r < repetitions; ++r) {
+    clustered = unionNefs(nefs, &stats);
+  }
+  t.stop();
+  const double clustered_ms = t.time() * 1000 / repetitions;
+  std::cout << "  unionNefs: " << clustered_ms << " ms (speedup "
+            << plain_ms / clustered_ms << "x, " << stats.clusters
+            << " clusters, " << stats.skipped_overlays
+            << " overlays skipped, same result: " << (clustered == sum) << ")"
+            << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+  const int repetitions = argc > 1 ? std::max(1, std::stoi(argv[1])) : 10;
+  for (bool group_coplanar : {false, true}) {
+    benchmark("touching_cubes", touching_cubes, repetitions, group_coplanar);
+    benchmark("tetracyl", tetracyl, repetitions, group_coplanar);
+  }
+  benchmarkDisjoint(3, repetitions);
+  return 0;
+}
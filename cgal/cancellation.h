@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Thrown by long running operations once their CancellationToken is
+// cancelled.
+class Cancelled : public std::runtime_error {
+public:
+  Cancelled() : std::runtime_error("cancelled") {}
+};
+
+// Called with a pipeline stage name (as in metrics.h), the number of steps
+// done and the total number of steps of that stage. Parallel variants call it
+// from pool threads, concurrently and not necessarily in order of done.
+using ProgressCallback =
+    std::function<void(const char *stage, size_t done, size_t total)>;
+
+// Cooperative cancellation: Operations taking a token poll it between steps
+// (e.g. between facets, volumes or parts) and throw Cancelled. A single CGAL
+// call, such as a Nef constructor, can't be interrupted, so cancellation only
+// takes effect once it returns. At the same points, checkpoint() reports
+// progress to the callback, if one is set.
+// cancel() only stores an atomic flag, so it may be called from a signal
+// handler.
+class CancellationToken {
+public:
+  CancellationToken() = default;
+  explicit CancellationToken(ProgressCallback progress)
+      : progress_(std::move(progress)) {}
+
+  void cancel() { cancelled_.store(true, std::memory_order_relaxed); }
+  bool cancelled() const { return cancelled_.load(std::memory_order_relaxed); }
+
+  void throwIfCancelled() const {
+    if (cancelled()) throw Cancelled();
+  }
+
+  void checkpoint(const char *stage, size_t done, size_t total) const {
+    if (progress_) progress_(stage, done, total);
+    throwIfCancelled();
+  }
+
+private:
+  std::atomic<bool> cancelled_{false};
+  ProgressCallback progress_;
+};
+
+inline void throwIfCancelled(const CancellationToken *token) {
+  if (token) token->throwIfCancelled();
+}
+
+inline void checkpoint(const CancellationToken *token, const char *stage,
+                       size_t done, size_t total) {
+  if (token) token->checkpoint(stage, done, total);
+}
+
+// Threads of cancelled workers that may still be inside an uninterruptible
+// call. Their callers return without waiting, so workers must own all their
+// data. Call joinAbandonedWorkers() before leaving main(), so no worker runs
+// during static destruction. Workers still running at exit (e.g. after an
+// error) are detached.
+struct AbandonedWorkers {
+  ~AbandonedWorkers() {
+    for (auto &worker : workers) worker.detach();
+  }
+
+  std::mutex mutex;
+  std::vector<std::thread> workers;
+};
+
+inline AbandonedWorkers abandoned_workers;
+
+inline void abandonWorker(std::thread &&worker) {
+  std::lock_guard<std::mutex> lock(abandoned_workers.mutex);
+  abandoned_workers.workers.push_back(std::move(worker));
+}
+
+inline void joinAbandonedWorkers() {
+  std::vector<std::thread> workers;
+  {
+    std::lock_guard<std::mutex> lock(abandoned_workers.mutex);
+    workers.swap(abandoned_workers.workers);
+  }
+  for (auto &worker : workers) worker.join();
+}
@@ -1,13 +1,97 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <iomanip>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <CGAL/Cartesian.h>
+#include <CGAL/Constrained_Delaunay_triangulation_2.h>
+#include <CGAL/Exact_predicates_exact_constructions_kernel.h>
+#include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
+#include <CGAL/Gmpq.h>
+#include <CGAL/Gmpz.h>
+#include <CGAL/Homogeneous.h>
+#include <CGAL/Lazy_exact_nt.h>
 #include <CGAL/Nef_nary_union_3.h>
+#include <CGAL/Polygon_mesh_processing/manifoldness.h>
+#include <CGAL/Polygon_mesh_processing/self_intersections.h>
+#include <CGAL/Polygon_mesh_processing/triangulate_faces.h>
+#include <CGAL/Polyhedron_3.h>
+#include <CGAL/Real_timer.h>
 #include <CGAL/Surface_mesh.h>
+#include <CGAL/Triangulation_2_projection_traits_3.h>
+#include <CGAL/Triangulation_face_base_with_info_2.h>
+#include <CGAL/Triangulation_vertex_base_with_info_2.h>
+#pragma push_macro("NDEBUG")
+#undef NDEBUG
+#include <CGAL/IO/Nef_polyhedron_iostream_3.h>
+#pragma pop_macro("NDEBUG")
+#include <CGAL/IO/STL.h>
+#include <CGAL/boost/graph/helpers.h>
 #include <CGAL/boost/graph/convert_nef_polyhedron_to_polygon_mesh.h>
 #include <CGAL/convex_decomposition_3.h>
 #include <CGAL/convex_hull_3.h>
 
-using NT3 = CGAL::Gmpq;
-using CGAL_Kernel3 = CGAL::Cartesian<NT3>;
+// Pool tasks share Nefs, points and exact numbers, e.g. the input of
+// decomposeBySlabs() or the facet points of the parallel face union. Their
+// reference counts are only atomic in a thread-safe CGAL build.
+#ifndef CGAL_HAS_THREADS
+#error "cgal_tools.h needs CGAL built with thread support (CGAL_HAS_THREADS)"
+#endif
+
+#include "cancellation.h"
+#include "merge_parts.h"
+#include "metrics.h"
+#include "nef_access.h"
+#include "nef_binary_io.h"
+#include "nef_concat.h"
+#include "nef_soup_builder.h"
+#include "thread_pool.h"
+
+// The exact kernel used by the tools is chosen per target by defining
+// CGAL_TOOLS_KERNEL, see CMakeLists.txt. The functions below are templated on
+// the kernel, so other kernels can be used side by side.
+#define CGAL_TOOLS_KERNEL_GMPQ 0  // Cartesian<Gmpq>: OpenSCAD's Nef kernel
+#define CGAL_TOOLS_KERNEL_EPECK 1 // Epeck: Lazy kernel, filtered predicates
+#define CGAL_TOOLS_KERNEL_LAZY 2  // Cartesian<Lazy_exact_nt<Gmpq>>
+#define CGAL_TOOLS_KERNEL_HOMOGENEOUS 3 // Homogeneous<Gmpz>, see snapToGrid()
+
+#ifndef CGAL_TOOLS_KERNEL
+#define CGAL_TOOLS_KERNEL CGAL_TOOLS_KERNEL_GMPQ
+#endif
+
+#if CGAL_TOOLS_KERNEL == CGAL_TOOLS_KERNEL_EPECK
+using CGAL_Kernel3 = CGAL::Epeck;
+constexpr const char *CGAL_Kernel3_name = "Epeck";
+#elif CGAL_TOOLS_KERNEL == CGAL_TOOLS_KERNEL_LAZY
+using CGAL_Kernel3 = CGAL::Cartesian<CGAL::Lazy_exact_nt<CGAL::Gmpq>>;
+constexpr const char *CGAL_Kernel3_name = "Cartesian<Lazy_exact_nt<Gmpq>>";
+#elif CGAL_TOOLS_KERNEL == CGAL_TOOLS_KERNEL_HOMOGENEOUS
+using CGAL_Kernel3 = CGAL::Homogeneous<CGAL::Gmpz>;
+constexpr const char *CGAL_Kernel3_name = "Homogeneous<Gmpz>";
+#else
+using CGAL_Kernel3 = CGAL::Cartesian<CGAL::Gmpq>;
+constexpr const char *CGAL_Kernel3_name = "Cartesian<Gmpq>";
+#endif
+
+using NT3 = CGAL_Kernel3::FT;
 using CGAL_Nef_polyhedron3 = CGAL::Nef_polyhedron_3<CGAL_Kernel3>;
 using CGAL_Vertex = CGAL::Point_3<CGAL_Kernel3>;
 using DoubleVertex = std::array<double, 3>;
@@ -15,15 +99,70 @@ using DoubleVertex = std::array<double, 3>;
 using Double_Kernel = CGAL::Simple_cartesian<double>;
 using Double_Point3 = CGAL::Point_3<Double_Kernel>;
 
+// Double coordinates, but exact predicates: Used for cheap mesh checks that
+// must agree with what the exact Nef constructor will see.
+using Epick_Point3 = CGAL::Epick::Point_3;
+using Epick_SurfaceMesh = CGAL::Surface_mesh<Epick_Point3>;
+
 struct Object {
   std::vector<DoubleVertex> vertices;
   std::vector<std::array<uint32_t, 3>> indices;
 };
 
-using SurfaceMesh = CGAL::Surface_mesh<CGAL_Vertex>;
+template <typename Kernel>
+using Kernel_SurfaceMesh = CGAL::Surface_mesh<CGAL::Point_3<Kernel>>;
+
+using SurfaceMesh = Kernel_SurfaceMesh<CGAL_Kernel3>;
+
+template <typename Kernel>
+Double_Point3 toDoublePoint(const CGAL::Point_3<Kernel> &p) {
+  return {CGAL::to_double(p.x()), CGAL::to_double(p.y()),
+          CGAL::to_double(p.z())};
+}
+
+// Set to make printStats() run the expensive is_simple() and is_valid()
+// checks. Off by default, so production runs don't pay for them.
+inline bool full_validity_checks = false;
+
+// Converts a double point to the exact kernel without rounding. For
+// Homogeneous<Gmpz>, every double is an integer times a power of two, so the
+// point gets integer coordinates over a power of two common denominator.
+template <typename Kernel>
+CGAL::Point_3<Kernel> toExactPoint(const DoubleVertex &v) {
+  if constexpr (std::is_same_v<Kernel, CGAL::Homogeneous<CGAL::Gmpz>>) {
+    std::array<int64_t, 3> mantissa;
+    std::array<int, 3> exponent;
+    int min_exponent = 0;
+    for (int i = 0; i < 3; ++i) {
+      int e = 0;
+      const double f = std::frexp(v[i], &e);
+      int64_t m = static_cast<int64_t>(std::ldexp(f, 53));
+      e -= 53;
+      while (m != 0 && m % 2 == 0) {
+        m /= 2;
+        ++e;
+      }
+      if (m == 0) e = 0;
+      mantissa[i] = m;
+      exponent[i] = e;
+      min_exponent = std::min(min_exponent, e);
+    }
+    std::array<CGAL::Gmpz, 4> h;
+    for (int i = 0; i < 3; ++i) {
+      h[i] = CGAL::Gmpz(static_cast<long>(mantissa[i]));
+      mpz_mul_2exp(h[i].mpz(), h[i].mpz(), exponent[i] - min_exponent);
+    }
+    h[3] = CGAL::Gmpz(1);
+    mpz_mul_2exp(h[3].mpz(), h[3].mpz(), -min_exponent);
+    return CGAL::Point_3<Kernel>(h[0], h[1], h[2], h[3]);
+  } else {
+    return CGAL::Point_3<Kernel>(v[0], v[1], v[2]);
+  }
+}
 
 template <typename Mesh>
 void writeMesh(const Mesh &mesh, const std::string &filename) {
+  ScopedStage stage("write", mesh.number_of_faces());
   bool write_ok = CGAL::IO::write_OFF(filename, mesh);
   if (!write_ok) {
     std::cerr << "Error writing mesh to output" << std::endl;
@@ -31,7 +170,26 @@ void writeMesh(const Mesh &mesh, const std::string &filename) {
   }
 }
 
-void writeNef(CGAL_Nef_polyhedron3 &nef, const std::string &filename) {
+// Kernels whose Nef polyhedra can be stored in the binary .nef3b format.
+template <typename Kernel>
+constexpr bool supportsBinaryNef = std::is_same_v<typename Kernel::FT, CGAL::Gmpq>;
+
+// Writes the binary format for .nef3b filenames, and the text format otherwise.
+template <typename Kernel>
+void writeNef(CGAL::Nef_polyhedron_3<Kernel> &nef, const std::string &filename) {
+  ScopedStage stage("write", nef.number_of_facets());
+  if (isBinaryNefFile(filename)) {
+    if constexpr (supportsBinaryNef<Kernel>) {
+      if (!writeNefBinary(nef, filename)) {
+        std::cerr << "Error writing Nef polyhedron to " << filename << std::endl;
+        exit(1);
+      }
+      return;
+    } else {
+      std::cerr << "Binary Nef files need a kernel with Gmpq coordinates" << std::endl;
+      exit(1);
+    }
+  }
   std::ofstream out(filename);
   if (!out) {
     std::cerr << "Error opening file for writing: " << filename << std::endl;
@@ -41,46 +199,651 @@ void writeNef(CGAL_Nef_polyhedron3 &nef, const std::string &filename) {
   out.close();
 }
 
-void printStats(CGAL_Nef_polyhedron3 &nef, const std::string &name) {
+// Reads a .nef3b binary or .nef3 text file, depending on the extension.
+template <typename Kernel>
+void readNef(const std::string &filename, CGAL::Nef_polyhedron_3<Kernel> &nef) {
+  ScopedStage stage("read");
+  if (isBinaryNefFile(filename)) {
+    if constexpr (supportsBinaryNef<Kernel>) {
+      if (!readNefBinary(filename, nef)) exit(1);
+    } else {
+      std::cerr << "Binary Nef files need a kernel with Gmpq coordinates" << std::endl;
+      exit(1);
+    }
+  } else {
+    std::ifstream in(filename);
+    if (!in) {
+      std::cerr << "Cannot open file " << filename << std::endl;
+      exit(1);
+    }
+    in >> nef;
+  }
+  stage.setOutputCount(nef.number_of_facets());
+}
+
+template <typename Kernel>
+void printStats(CGAL::Nef_polyhedron_3<Kernel> &nef, const std::string &name) {
 
   std::cout << name << ":\n";
-  std::cout << "  is_simple: " << nef.is_simple() << std::endl;
-  std::cout << "  is_valid: " << nef.is_valid() << std::endl;
+  if (full_validity_checks) {
+    std::cout << "  is_simple: " << nef.is_simple() << std::endl;
+    std::cout << "  is_valid: " << nef.is_valid() << std::endl;
+  }
   std::cout << "  is_bounded: " << nef.is_bounded() << std::endl;
   std::cout << "  number_of_vertices: " << nef.number_of_vertices()
             << std::endl;
   std::cout << "  number_of_volumes: " << nef.number_of_volumes() << std::endl;
 }
 
-SurfaceMesh createSurfaceMesh(const Object &obj) {
+struct GridKeyHash {
+  size_t operator()(const std::array<int64_t, 3> &key) const {
+    size_t h = 0;
+    for (const auto c : key) {
+      h = h * 0x9E3779B97F4A7C15ull + std::hash<int64_t>()(c);
+    }
+    return h;
+  }
+};
+
+// Merges coincident vertices in one pass over the vertices and one over the
+// indices. With epsilon == 0, only identical coordinates are merged.
+// Otherwise, vertices are hashed into a grid with cell size epsilon, and a
+// vertex is merged into the first kept vertex within epsilon (per coordinate)
+// found in its own or a neighbouring cell. Faces which become degenerate are
+// dropped. A non-finite or negative epsilon is treated as 0, and vertices with
+// non-finite coordinates are never merged.
+inline Object weldVertices(const Object &obj, double epsilon, size_t &num_merged) {
+  using Key = std::array<int64_t, 3>;
+  if (!std::isfinite(epsilon) || epsilon < 0) epsilon = 0;
+  Object welded;
+  welded.vertices.reserve(obj.vertices.size());
+  std::vector<uint32_t> remap(obj.vertices.size());
+  std::unordered_map<Key, std::vector<uint32_t>, GridKeyHash> grid;
+  grid.reserve(obj.vertices.size());
+
+  auto cellOf = [epsilon](const DoubleVertex &v) {
+    Key key;
+    for (int i = 0; i < 3; ++i) {
+      // Cells beyond +-2^62 (huge coordinates, tiny epsilon, Inf or NaN) don't
+      // fit the key, and their neighbours would overflow it: Those fall back
+      // to the exact key below. Keys of both kinds may collide, which only
+      // costs a comparison.
+      const double cell = epsilon > 0 ? std::floor(v[i] / epsilon) : 0;
+      if (epsilon > 0 && std::abs(cell) < 0x1p62) {
+        key[i] = static_cast<int64_t>(cell);
+      } else {
+        const double c = v[i] == 0 ? 0.0 : v[i]; // -0.0 == 0.0
+        std::memcpy(&key[i], &c, sizeof(c));
+      }
+    }
+    return key;
+  };
+  auto findMatch = [&](const DoubleVertex &v, const Key &key) -> int64_t {
+    const int r = epsilon > 0 ? 1 : 0;
+    for (int dx = -r; dx <= r; ++dx) {
+      for (int dy = -r; dy <= r; ++dy) {
+        for (int dz = -r; dz <= r; ++dz) {
+          auto it = grid.find({key[0] + dx, key[1] + dy, key[2] + dz});
+          if (it == grid.end()) continue;
+          for (const auto j : it->second) {
+            const auto &w = welded.vertices[j];
+            if (std::abs(v[0] - w[0]) <= epsilon &&
+                std::abs(v[1] - w[1]) <= epsilon &&
+                std::abs(v[2] - w[2]) <= epsilon) {
+              return j;
+            }
+          }
+        }
+      }
+    }
+    return -1;
+  };
+
+  for (size_t i = 0; i < obj.vertices.size(); ++i) {
+    const auto &v = obj.vertices[i];
+    const Key key = cellOf(v);
+    const int64_t match = findMatch(v, key);
+    if (match >= 0) {
+      remap[i] = match;
+    } else {
+      remap[i] = welded.vertices.size();
+      grid[key].push_back(remap[i]);
+      welded.vertices.push_back(v);
+    }
+  }
+
+  welded.indices.reserve(obj.indices.size());
+  for (const auto &f : obj.indices) {
+    const std::array<uint32_t, 3> g = {remap[f[0]], remap[f[1]], remap[f[2]]};
+    if (g[0] != g[1] && g[1] != g[2] && g[2] != g[0]) {
+      welded.indices.push_back(g);
+    }
+  }
+  num_merged = obj.vertices.size() - welded.vertices.size();
+  return welded;
+}
+
+// Snaps every coordinate to the nearest multiple of 2^-grid_bits, then merges
+// vertices that became identical and drops faces that collapsed. With inputs
+// on a power of two grid, exact numbers stay small: Homogeneous<Gmpz> points
+// share the denominator 2^grid_bits (see toExactPoint()), and Cartesian<Gmpq>
+// coordinates are dyadic rationals.
+inline Object snapToGrid(const Object &obj, int grid_bits, size_t &num_merged) {
+  ScopedStage stage("snap", obj.vertices.size());
+  Object snapped = obj;
+  for (auto &v : snapped.vertices) {
+    for (auto &c : v) {
+      c = std::ldexp(std::nearbyint(std::ldexp(c, grid_bits)), -grid_bits);
+    }
+  }
+  Object result = weldVertices(snapped, 0, num_merged);
+  stage.setOutputCount(result.vertices.size());
+  return result;
+}
+
+// Reads an ASCII or binary STL file. Identical vertices are merged.
+inline Object readSTL(const std::string &filename) {
+  std::vector<std::array<double, 3>> points;
+  std::vector<std::array<std::size_t, 3>> triangles;
+  if (!CGAL::IO::read_STL(filename, points, triangles)) {
+    std::cerr << "Error reading STL file " << filename << std::endl;
+    exit(1);
+  }
+  Object obj;
+  obj.vertices.assign(points.begin(), points.end());
+  for (const auto &t : triangles) {
+    obj.indices.push_back({static_cast<uint32_t>(t[0]),
+                           static_cast<uint32_t>(t[1]),
+                           static_cast<uint32_t>(t[2])});
+  }
+  return obj;
+}
+
+// Axis-aligned box from lo to hi as 12 outward oriented triangles.
+inline Object boxObject(const DoubleVertex &lo, const DoubleVertex &hi) {
+  Object box;
+  for (int i = 0; i < 8; ++i) {
+    box.vertices.push_back({i & 1 ? hi[0] : lo[0], i & 2 ? hi[1] : lo[1],
+                            i & 4 ? hi[2] : lo[2]});
+  }
+  box.indices = {{0, 2, 3}, {0, 3, 1}, {4, 5, 7}, {4, 7, 6},
+                 {0, 1, 5}, {0, 5, 4}, {2, 6, 7}, {2, 7, 3},
+                 {0, 4, 6}, {0, 6, 2}, {1, 3, 7}, {1, 7, 5}};
+  return box;
+}
+
+// Result of splitNonManifold().
+struct ManifoldStats {
+  size_t boundary_edges = 0;        // used by a single face
+  size_t non_manifold_edges = 0;    // used by more than two faces, or twice
+                                    // in the same direction
+  size_t non_manifold_vertices = 0; // faces around them form several fans
+  size_t added_vertices = 0;        // copies created by the splitting
+  size_t shells = 0;                // connected face sets after splitting
+  size_t inverted_shells = 0;       // with negative signed volume
+  bool closed = false; // after splitting, every edge has two opposite faces
+
+  bool isManifold() const {
+    return non_manifold_edges == 0 && non_manifold_vertices == 0;
+  }
+};
+
+constexpr uint32_t no_mate = std::numeric_limits<uint32_t>::max();
+
+// Pairs the halfedges of a triangle soup, where halfedge 3 * f + k runs from
+// corner k to corner k + 1 of face f. Edges used by exactly two faces in
+// opposite directions get mate[h] set to the other halfedge; all others keep
+// no_mate and are counted. Sorting the edge table dominates the cost.
+inline void pairHalfedges(const std::vector<std::array<uint32_t, 3>> &indices,
+                          std::vector<uint32_t> &mate, size_t &boundary_edges,
+                          size_t &non_manifold_edges) {
+  std::vector<std::pair<uint64_t, uint32_t>> table(3 * indices.size());
+  for (size_t f = 0; f < indices.size(); ++f) {
+    for (int k = 0; k < 3; ++k) {
+      const uint64_t a = indices[f][k], b = indices[f][(k + 1) % 3];
+      table[3 * f + k] = {std::min(a, b) << 32 | std::max(a, b), 3 * f + k};
+    }
+  }
+  std::sort(table.begin(), table.end());
+
+  auto source = [&indices](uint32_t h) { return indices[h / 3][h % 3]; };
+  mate.assign(table.size(), no_mate);
+  boundary_edges = non_manifold_edges = 0;
+  for (size_t i = 0, j; i < table.size(); i = j) {
+    for (j = i + 1; j < table.size() && table[j].first == table[i].first; ++j) {
+    }
+    if (j - i == 1) {
+      boundary_edges++;
+    } else if (j - i == 2 &&
+               source(table[i].second) != source(table[i + 1].second)) {
+      mate[table[i].second] = table[i + 1].second;
+      mate[table[i + 1].second] = table[i].second;
+    } else {
+      non_manifold_edges++;
+    }
+  }
+}
+
+// Linear pre-pass (apart from sorting the edge table) that makes a triangle
+// soup manifold where that is possible without changing its geometry:
+// Non-manifold edges are cut, and every vertex whose incident faces then form
+// several fans gets one copy per fan. Solids touching along edges or at
+// vertices thus become separate closed shells with coincident vertices.
+// Other than the new vertices, which are appended, indices are kept.
+inline Object splitNonManifold(const Object &obj, ManifoldStats *stats = nullptr) {
+  ScopedStage stage("manifold_split", obj.indices.size());
+  ManifoldStats local_stats;
+  ManifoldStats &s = stats ? *stats : local_stats;
+  s = ManifoldStats{};
+
+  std::vector<uint32_t> mate;
+  pairHalfedges(obj.indices, mate, s.boundary_edges, s.non_manifold_edges);
+
+  // Corner 3 * f + k is corner k of face f. The two corners at either end of
+  // a paired edge belong to the same fan.
+  std::vector<uint32_t> parent(mate.size());
+  std::iota(parent.begin(), parent.end(), 0);
+  auto find = [&parent](uint32_t i) {
+    while (parent[i] != i) i = parent[i] = parent[parent[i]];
+    return i;
+  };
+  auto next = [](uint32_t c) { return c - c % 3 + (c + 1) % 3; };
+  for (uint32_t h = 0; h < mate.size(); ++h) {
+    if (mate[h] == no_mate || mate[h] < h) continue;
+    parent[find(h)] = find(next(mate[h]));
+    parent[find(next(h))] = find(mate[h]);
+  }
+
+  Object split = obj;
+  std::vector<uint32_t> vertex_of_fan(mate.size(), no_mate);
+  std::vector<uint8_t> fans(obj.vertices.size(), 0);
+  for (uint32_t c = 0; c < mate.size(); ++c) {
+    const uint32_t v = obj.indices[c / 3][c % 3];
+    uint32_t &copy = vertex_of_fan[find(c)];
+    if (copy == no_mate) {
+      if (fans[v] == 0) {
+        copy = v;
+      } else {
+        copy = split.vertices.size();
+        split.vertices.push_back(obj.vertices[v]);
+      }
+      if (fans[v] == 1) s.non_manifold_vertices++;
+      fans[v] = std::min(fans[v] + 1, 2);
+    }
+    split.indices[c / 3][c % 3] = copy;
+  }
+  s.added_vertices = split.vertices.size() - obj.vertices.size();
+
+  size_t boundary_edges, non_manifold_edges;
+  pairHalfedges(split.indices, mate, boundary_edges, non_manifold_edges);
+  s.closed = boundary_edges == 0 && non_manifold_edges == 0;
+
+  // Shells and their signed volumes, six times the actual volume.
+  parent.resize(split.indices.size());
+  std::iota(parent.begin(), parent.end(), 0);
+  for (uint32_t h = 0; h < mate.size(); ++h) {
+    if (mate[h] != no_mate) parent[find(h / 3)] = find(mate[h] / 3);
+  }
+  std::vector<double> volume(split.indices.size(), 0);
+  for (uint32_t f = 0; f < split.indices.size(); ++f) {
+    const auto &a = split.vertices[split.indices[f][0]];
+    const auto &b = split.vertices[split.indices[f][1]];
+    const auto &c = split.vertices[split.indices[f][2]];
+    volume[find(f)] += a[0] * (b[1] * c[2] - b[2] * c[1]) +
+                       a[1] * (b[2] * c[0] - b[0] * c[2]) +
+                       a[2] * (b[0] * c[1] - b[1] * c[0]);
+  }
+  for (uint32_t f = 0; f < split.indices.size(); ++f) {
+    if (find(f) != f) continue;
+    s.shells++;
+    if (volume[f] < 0) s.inverted_shells++;
+  }
+  stage.setOutputCount(s.shells);
+  return split;
+}
+
+// If weld_epsilon is given, coincident vertices are merged first, see
+// weldVertices(). The number of merged vertices is stored in num_merged if
+// given, and is the difference of the input and output counts of the "weld"
+// stage.
+template <typename Kernel = CGAL_Kernel3>
+Kernel_SurfaceMesh<Kernel>
+createSurfaceMesh(const Object &obj,
+                  std::optional<double> weld_epsilon = std::nullopt,
+                  size_t *num_merged = nullptr) {
+  using SurfaceMesh = Kernel_SurfaceMesh<Kernel>;
+  if (weld_epsilon) {
+    size_t merged = 0;
+    Object welded;
+    {
+      ScopedStage stage("weld", obj.vertices.size());
+      welded = weldVertices(obj, *weld_epsilon, merged);
+      stage.setOutputCount(welded.vertices.size());
+    }
+    if (num_merged) *num_merged = merged;
+    return createSurfaceMesh<Kernel>(welded);
+  }
+
+  ScopedStage stage("mesh_build", obj.indices.size());
   SurfaceMesh mesh;
+  mesh.reserve(obj.vertices.size(), obj.indices.size() * 3 / 2,
+               obj.indices.size());
 
   for (const auto &v : obj.vertices) {
-    mesh.add_vertex({v[0], v[1], v[2]});
+    mesh.add_vertex(toExactPoint<Kernel>(v));
   }
   for (const auto &f : obj.indices) {
-    mesh.add_face(SurfaceMesh::Vertex_index(f[0]),
-                  SurfaceMesh::Vertex_index(f[1]),
-                  SurfaceMesh::Vertex_index(f[2]));
+    mesh.add_face(typename SurfaceMesh::Vertex_index(f[0]),
+                  typename SurfaceMesh::Vertex_index(f[1]),
+                  typename SurfaceMesh::Vertex_index(f[2]));
   }
+  stage.setOutputCount(mesh.number_of_faces());
   return mesh;
 }
 
-void convertNefToSurfaceMesh(const CGAL_Nef_polyhedron3 &nef,
-                             SurfaceMesh &mesh) {
+template <typename Kernel>
+void convertNefToSurfaceMesh(const CGAL::Nef_polyhedron_3<Kernel> &nef,
+                             Kernel_SurfaceMesh<Kernel> &mesh) {
   constexpr bool triangulate = false;
   CGAL::convert_nef_polyhedron_to_polygon_mesh(nef, mesh, triangulate);
 }
 
-CGAL_Nef_polyhedron3 unionMeshFacesToNef(const SurfaceMesh &mesh) {
-  CGAL::Nef_nary_union_3<CGAL_Nef_polyhedron3> nary_union;
-  int discarded_facets = 0;
-  for (const auto face : mesh.faces()) {
-    std::vector<CGAL::Point_3<CGAL_Kernel3>> vertices;
+// Triangulates one facet given as boundary cycles of Object vertex indices
+// (outer boundary and holes, in any order) with a constrained Delaunay
+// triangulation in the plane orthogonal to normal. Triangles inside the facet
+// are appended counterclockwise as seen from the tip of normal.
+template <typename Kernel>
+void triangulateFacet(const std::vector<std::vector<uint32_t>> &cycles,
+                      const std::vector<CGAL::Point_3<Kernel>> &points,
+                      const typename Kernel::Vector_3 &normal,
+                      std::vector<std::array<uint32_t, 3>> &triangles) {
+  using Traits = CGAL::Triangulation_2_projection_traits_3<Kernel>;
+  using Vb = CGAL::Triangulation_vertex_base_with_info_2<uint32_t, Traits>;
+  using Fbi = CGAL::Triangulation_face_base_with_info_2<int, Traits>;
+  using Fb = CGAL::Constrained_triangulation_face_base_2<Traits, Fbi>;
+  using Tds = CGAL::Triangulation_data_structure_2<Vb, Fb>;
+  using CDT = CGAL::Constrained_Delaunay_triangulation_2<Traits, Tds,
+                                                          CGAL::Exact_predicates_tag>;
+
+  CDT cdt{Traits(normal)};
+  for (const auto &cycle : cycles) {
+    typename CDT::Vertex_handle first, previous;
+    for (const uint32_t index : cycle) {
+      auto vh = cdt.insert(points[index]);
+      vh->info() = index;
+      if (previous != typename CDT::Vertex_handle()) {
+        cdt.insert_constraint(previous, vh);
+      } else {
+        first = vh;
+      }
+      previous = vh;
+    }
+    cdt.insert_constraint(previous, first);
+  }
+
+  // Nesting level of every face: 0 outside, odd levels are inside the facet.
+  for (auto fh = cdt.all_faces_begin(); fh != cdt.all_faces_end(); ++fh) {
+    fh->info() = -1;
+  }
+  std::vector<typename CDT::Edge> border;
+  auto markDomain = [&](typename CDT::Face_handle start, int level) {
+    if (start->info() != -1) return;
+    std::vector<typename CDT::Face_handle> queue{start};
+    while (!queue.empty()) {
+      auto fh = queue.back();
+      queue.pop_back();
+      if (fh->info() != -1) continue;
+      fh->info() = level;
+      for (int i = 0; i < 3; ++i) {
+        auto neighbor = fh->neighbor(i);
+        if (neighbor->info() != -1) continue;
+        if (cdt.is_constrained(typename CDT::Edge(fh, i))) {
+          border.emplace_back(fh, i);
+        } else {
+          queue.push_back(neighbor);
+        }
+      }
+    }
+  };
+  markDomain(cdt.infinite_face(), 0);
+  while (!border.empty()) {
+    const auto e = border.back();
+    border.pop_back();
+    auto neighbor = e.first->neighbor(e.second);
+    markDomain(neighbor, e.first->info() + 1);
+  }
+
+  for (auto fh = cdt.finite_faces_begin(); fh != cdt.finite_faces_end(); ++fh) {
+    if (fh->info() % 2 == 1) {
+      triangles.push_back({fh->vertex(0)->info(), fh->vertex(1)->info(),
+                           fh->vertex(2)->info()});
+    }
+  }
+}
+
+// Exports the boundary of nef's solid parts as double precision triangles,
+// without building an exact Surface_mesh first. Every Nef vertex becomes one
+// Object vertex, so vertices are shared between facets. Strictly convex facets
+// without holes are fan triangulated; other facets, or all of them with
+// constrained_triangulation, use triangulateFacet().
+template <typename Kernel>
+Object convertNefToObject(const CGAL::Nef_polyhedron_3<Kernel> &nef,
+                          bool constrained_triangulation = false) {
+  using Nef = CGAL::Nef_polyhedron_3<Kernel>;
+  using Point_3 = CGAL::Point_3<Kernel>;
+  using Vector_3 = typename Kernel::Vector_3;
+  ScopedStage stage("nef_export", nef.number_of_facets());
+
+  Object obj;
+  obj.vertices.reserve(nef.number_of_vertices());
+  std::vector<Point_3> points;
+  points.reserve(nef.number_of_vertices());
+  std::unordered_map<const void *, uint32_t> vertex_index;
+  auto indexOf = [&](typename Nef::Vertex_const_handle v) {
+    auto [it, inserted] = vertex_index.emplace(&*v, points.size());
+    if (inserted) {
+      points.push_back(v->point());
+      const auto p = toDoublePoint(v->point());
+      obj.vertices.push_back({p.x(), p.y(), p.z()});
+    }
+    return it->second;
+  };
+
+  std::vector<std::vector<uint32_t>> cycles;
+  for (auto f = nef.halffacets_begin(); f != nef.halffacets_end(); ++f) {
+    // Boundary facets of solids, seen from the outside: those cycles are
+    // oriented counterclockwise around the outward normal.
+    if (f->incident_volume()->mark() || !f->twin()->incident_volume()->mark()) {
+      continue;
+    }
+    cycles.clear();
+    for (auto fc = f->facet_cycles_begin(); fc != f->facet_cycles_end(); ++fc) {
+      if (!fc.is_shalfedge()) continue;
+      auto &cycle = cycles.emplace_back();
+      typename Nef::SHalfedge_const_handle se(fc);
+      typename Nef::SHalfedge_around_facet_const_circulator hc(se), hend(hc);
+      CGAL_For_all(hc, hend) { cycle.push_back(indexOf(hc->source()->center_vertex())); }
+    }
+    if (cycles.empty()) continue;
+
+    // The outer cycle encloses the largest area; its Newell normal points
+    // outwards.
+    const Vector_3 plane_normal = f->plane().orthogonal_vector();
+    Vector_3 outward = CGAL::NULL_VECTOR;
+    typename Kernel::FT largest_area = 0;
+    for (const auto &cycle : cycles) {
+      Vector_3 newell = CGAL::NULL_VECTOR;
+      for (size_t i = 0; i < cycle.size(); ++i) {
+        const Vector_3 a = points[cycle[i]] - CGAL::ORIGIN;
+        const Vector_3 b = points[cycle[(i + 1) % cycle.size()]] - CGAL::ORIGIN;
+        newell = newell + CGAL::cross_product(a, b);
+      }
+      const auto area = CGAL::abs(newell * plane_normal);
+      if (area > largest_area) {
+        largest_area = area;
+        outward = newell;
+      }
+    }
+    if (outward == CGAL::NULL_VECTOR) continue; // degenerate facet
+
+    bool strictly_convex = cycles.size() == 1 && cycles.front().size() >= 3;
+    const auto &outer = cycles.front();
+    for (size_t i = 0; strictly_convex && !constrained_triangulation &&
+                       i < outer.size(); ++i) {
+      const Point_3 &a = points[outer[i]];
+      const Point_3 &b = points[outer[(i + 1) % outer.size()]];
+      const Point_3 &c = points[outer[(i + 2) % outer.size()]];
+      strictly_convex = CGAL::orientation(a, b, c, a + outward) == CGAL::POSITIVE;
+    }
+    if (strictly_convex && !constrained_triangulation) {
+      for (size_t i = 1; i + 1 < outer.size(); ++i) {
+        obj.indices.push_back({outer[0], outer[i], outer[i + 1]});
+      }
+    } else {
+      triangulateFacet(cycles, points, outward, obj.indices);
+    }
+  }
+  stage.setOutputCount(obj.indices.size());
+  return obj;
+}
+
+// Writes obj as OFF, with enough digits to round-trip the doubles exactly.
+inline void writeObject(const Object &obj, const std::string &filename) {
+  ScopedStage stage("write", obj.indices.size());
+  std::ofstream out(filename);
+  if (!out) {
+    std::cerr << "Error opening file for writing: " << filename << std::endl;
+    exit(1);
+  }
+  out << std::setprecision(std::numeric_limits<double>::max_digits10);
+  out << "OFF\n" << obj.vertices.size() << " " << obj.indices.size() << " 0\n";
+  for (const auto &v : obj.vertices) {
+    out << v[0] << " " << v[1] << " " << v[2] << "\n";
+  }
+  for (const auto &t : obj.indices) {
+    out << "3 " << t[0] << " " << t[1] << " " << t[2] << "\n";
+  }
+  if (!out) {
+    std::cerr << "Error writing mesh to output" << std::endl;
+    exit(1);
+  }
+}
+
+// Returns the vertices of each face as a polygon. With group_coplanar, each
+// region of edge-adjacent faces lying in the same plane (without folding over)
+// becomes one polygon instead, so e.g. a tessellated flat side of a CAD part
+// turns into a single Nef operand. Regions whose boundary is not one simple
+// loop (holes, pinched vertices) are kept as individual faces.
+template <typename Kernel>
+std::vector<std::vector<CGAL::Point_3<Kernel>>>
+collectFacetPolygons(const Kernel_SurfaceMesh<Kernel> &mesh,
+                     bool group_coplanar) {
+  using SurfaceMesh = Kernel_SurfaceMesh<Kernel>;
+  using Face_index = typename SurfaceMesh::Face_index;
+  using Halfedge_index = typename SurfaceMesh::Halfedge_index;
+  ScopedStage stage("coplanar_grouping", mesh.number_of_faces());
+
+  std::vector<std::vector<CGAL::Point_3<Kernel>>> polygons;
+  polygons.reserve(mesh.number_of_faces());
+  auto addFace = [&](Face_index face) {
+    auto &vertices = polygons.emplace_back();
     for (auto vd : CGAL::vertices_around_face(mesh.halfedge(face), mesh)) {
       vertices.push_back(mesh.point(vd));
     }
+  };
+
+  if (!group_coplanar) {
+    for (const auto face : mesh.faces()) addFace(face);
+    stage.setOutputCount(polygons.size());
+    return polygons;
+  }
+
+  // True if the faces on both sides of h are coplanar and consistently
+  // oriented, i.e. their third vertices lie on opposite sides of h.
+  auto isFlatEdge = [&](Halfedge_index h) {
+    const auto o = mesh.opposite(h);
+    if (mesh.is_border(h) || mesh.is_border(o)) return false;
+    const auto &a = mesh.point(mesh.source(h));
+    const auto &b = mesh.point(mesh.target(h));
+    const auto &c = mesh.point(mesh.target(mesh.next(h)));
+    const auto &d = mesh.point(mesh.target(mesh.next(o)));
+    return !CGAL::collinear(a, b, c) && CGAL::coplanar(a, b, c, d) &&
+           CGAL::coplanar_orientation(a, b, c, d) == CGAL::NEGATIVE;
+  };
+
+  constexpr size_t unassigned = std::numeric_limits<size_t>::max();
+  std::vector<size_t> region_of(mesh.num_faces(), unassigned);
+  std::vector<Face_index> region;
+  std::unordered_map<size_t, Halfedge_index> boundary_from;
+  for (const auto seed : mesh.faces()) {
+    if (region_of[seed] != unassigned) continue;
+    const size_t region_id = seed;
+
+    region.assign(1, seed);
+    region_of[seed] = region_id;
+    for (size_t i = 0; i < region.size(); ++i) {
+      for (auto h : CGAL::halfedges_around_face(mesh.halfedge(region[i]), mesh)) {
+        const auto neighbour = mesh.face(mesh.opposite(h));
+        if (neighbour != SurfaceMesh::null_face() &&
+            region_of[neighbour] == unassigned && isFlatEdge(h)) {
+          region_of[neighbour] = region_id;
+          region.push_back(neighbour);
+        }
+      }
+    }
+    if (region.size() == 1) {
+      addFace(seed);
+      continue;
+    }
+
+    // Walk the region boundary. It must be a single loop visiting every
+    // boundary vertex once.
+    boundary_from.clear();
+    bool simple = true;
+    for (const auto face : region) {
+      for (auto h : CGAL::halfedges_around_face(mesh.halfedge(face), mesh)) {
+        const auto o = mesh.opposite(h);
+        if (!mesh.is_border(o) && region_of[mesh.face(o)] == region_id) continue;
+        simple &= boundary_from.emplace(size_t(mesh.source(h)), h).second;
+      }
+    }
+    std::vector<CGAL::Point_3<Kernel>> polygon;
+    if (simple && !boundary_from.empty()) {
+      const Halfedge_index start = boundary_from.begin()->second;
+      Halfedge_index h = start;
+      do {
+        polygon.push_back(mesh.point(mesh.source(h)));
+        auto it = boundary_from.find(size_t(mesh.target(h)));
+        if (it == boundary_from.end()) break;
+        h = it->second;
+      } while (h != start && polygon.size() <= boundary_from.size());
+      simple = h == start && polygon.size() == boundary_from.size();
+    }
+    if (simple) {
+      polygons.push_back(std::move(polygon));
+    } else {
+      for (const auto face : region) addFace(face);
+    }
+  }
+  stage.setOutputCount(polygons.size());
+  return polygons;
+}
 
+// If a token is given, it is checked before every facet and before the final
+// union, see CancellationToken.
+template <typename Kernel>
+CGAL::Nef_polyhedron_3<Kernel>
+unionMeshFacesToNef(const Kernel_SurfaceMesh<Kernel> &mesh,
+                    bool group_coplanar = true,
+                    const CancellationToken *token = nullptr) {
+  using CGAL_Nef_polyhedron3 = CGAL::Nef_polyhedron_3<Kernel>;
+  ScopedStage stage("fallback_union", mesh.number_of_faces());
+  CGAL::Nef_nary_union_3<CGAL_Nef_polyhedron3> nary_union;
+  int discarded_facets = 0;
+  const auto facets = collectFacetPolygons(mesh, group_coplanar);
+  for (size_t i = 0; i < facets.size(); ++i) {
+    checkpoint(token, "fallback_union", i, facets.size());
+    const auto &vertices = facets[i];
     bool is_nef = false;
     if (vertices.size() >= 1) {
       CGAL_Nef_polyhedron3 nef(vertices.begin(), vertices.end());
@@ -96,104 +859,1121 @@ CGAL_Nef_polyhedron3 unionMeshFacesToNef(const SurfaceMesh &mesh) {
   if (discarded_facets > 0) {
     std::cerr << "Discarded " << discarded_facets << " facets." << std::endl;
   }
+  checkpoint(token, "fallback_union", facets.size(), facets.size());
   CGAL_Nef_polyhedron3 nef_union = nary_union.get_union();
   CGAL::Mark_bounded_volumes<CGAL_Nef_polyhedron3> mbv(true);
   nef_union.delegate(mbv);
+  stage.setOutputCount(nef_union.number_of_facets());
   return nef_union;
 }
 
-CGAL_Nef_polyhedron3 convertSurfaceMeshToNef(const SurfaceMesh &mesh) {
-  // Note: This may cause a CGAL exception if the input mesh is
+// Parallel variant of unionMeshFacesToNef(): The per-facet Nefs are built
+// concurrently, then reduced as a balanced binary tree where every level's
+// pairwise unions run on the pool. Union is associative, so the result is the
+// same point set as the sequential Nef_nary_union_3.
+// A token is checked before every facet and every pairwise union; progress
+// counts both, n facets and at most n - 1 unions.
+template <typename Kernel>
+CGAL::Nef_polyhedron_3<Kernel>
+unionMeshFacesToNef(const Kernel_SurfaceMesh<Kernel> &mesh, ThreadPool &pool,
+                    bool group_coplanar = true,
+                    const CancellationToken *token = nullptr) {
+  using CGAL_Nef_polyhedron3 = CGAL::Nef_polyhedron_3<Kernel>;
+  ScopedStage stage("fallback_union", mesh.number_of_faces());
+  // Gather facet vertices up front. The points are still shared with the
+  // mesh, and every facet Nef and pairwise union copies and releases handles
+  // to the same exact numbers from several threads; cgal_tools.h requires
+  // CGAL_HAS_THREADS for that.
+  const auto facets = collectFacetPolygons(mesh, group_coplanar);
+  const size_t total_steps = facets.empty() ? 0 : 2 * facets.size() - 1;
+  std::atomic<size_t> steps{0};
+
+  std::vector<CGAL_Nef_polyhedron3> facet_nefs(facets.size());
+  std::vector<char> is_nef(facets.size(), false);
+  pool.parallel_for(facets.size(), [&](size_t i) {
+    checkpoint(token, "fallback_union", steps++, total_steps);
+    const auto &vertices = facets[i];
+    if (vertices.size() >= 1) {
+      CGAL_Nef_polyhedron3 nef(vertices.begin(), vertices.end());
+      if (!nef.is_empty()) {
+        facet_nefs[i] = std::move(nef);
+        is_nef[i] = true;
+      }
+    }
+  });
+
+  std::vector<CGAL_Nef_polyhedron3> level;
+  level.reserve(facet_nefs.size());
+  for (size_t i = 0; i < facet_nefs.size(); ++i) {
+    if (is_nef[i]) level.push_back(std::move(facet_nefs[i]));
+  }
+  const size_t discarded_facets = facets.size() - level.size();
+  if (discarded_facets > 0) {
+    std::cerr << "Discarded " << discarded_facets << " facets." << std::endl;
+  }
+  steps += discarded_facets; // no unions for those
+
+  while (level.size() > 1) {
+    std::vector<CGAL_Nef_polyhedron3> next((level.size() + 1) / 2);
+    pool.parallel_for(next.size(), [&](size_t i) {
+      if (2 * i + 1 < level.size()) {
+        checkpoint(token, "fallback_union", steps++, total_steps);
+        next[i] = level[2 * i] + level[2 * i + 1];
+      } else {
+        next[i] = std::move(level[2 * i]);
+      }
+    });
+    level = std::move(next);
+  }
+  checkpoint(token, "fallback_union", total_steps, total_steps);
+
+  CGAL_Nef_polyhedron3 nef_union =
+      level.empty() ? CGAL_Nef_polyhedron3() : std::move(level.front());
+  CGAL::Mark_bounded_volumes<CGAL_Nef_polyhedron3> mbv(true);
+  nef_union.delegate(mbv);
+  stage.setOutputCount(nef_union.number_of_facets());
+  return nef_union;
+}
+
+// Takes over nef's SNC and leaves nef empty. Copies of a Nef_polyhedron_3
+// share one SNC, and Nef_polyhedron_3 has no move constructor, so std::move
+// alone would keep the caller's reference alive. The first modification
+// (e.g. convex_decomposition_3) would then clone the whole SNC.
+template <typename Kernel>
+CGAL::Nef_polyhedron_3<Kernel> takeNef(CGAL::Nef_polyhedron_3<Kernel> &nef) {
+  CGAL::Nef_polyhedron_3<Kernel> owned = nef;
+  nef = CGAL::Nef_polyhedron_3<Kernel>();
+  return owned;
+}
+
+// Statistics of a unionNefs() call. Without the bounding box clustering,
+// every operand after the first would cost one overlay.
+struct UnionStats {
+  size_t operands = 0;
+  size_t clusters = 0;
+  size_t overlays = 0;
+  size_t skipped_overlays = 0;
+};
+
+// Unions Nef polyhedra, overlaying only operands whose bounding boxes overlap.
+// The operands are clustered by sweep-and-prune over their bounding boxes
+// (touching boxes count as overlapping), each cluster is unioned with
+// Nef_nary_union_3, and the resulting pairwise disjoint solids are combined by
+// concatenating their SNC structures instead of overlaying them.
+// This overload consumes the operands: Each one is released as soon as it has
+// been added to its cluster's union.
+template <typename Kernel>
+CGAL::Nef_polyhedron_3<Kernel>
+unionNefs(std::vector<CGAL::Nef_polyhedron_3<Kernel>> &&operands,
+          UnionStats *stats = nullptr) {
+  using CGAL_Nef_polyhedron3 = CGAL::Nef_polyhedron_3<Kernel>;
+  ScopedStage stage("bbox_union", operands.size());
+  UnionStats local_stats;
+  UnionStats &s = stats ? *stats : local_stats;
+  s = UnionStats{operands.size()};
+
+  // Empty operands don't change the union. Unbounded ones (marked outer
+  // volume) can't be concatenated, so they all go into a single cluster.
+  std::vector<size_t> order;
+  std::vector<CGAL::Bbox_3> boxes(operands.size());
+  bool all_bounded = true;
+  for (size_t i = 0; i < operands.size(); ++i) {
+    const auto &nef = operands[i];
+    if (nef.is_empty()) continue;
+    all_bounded = all_bounded && !nef.volumes_begin()->mark();
+    for (auto v = nef.vertices_begin(); v != nef.vertices_end(); ++v) {
+      boxes[i] += v->point().bbox();
+    }
+    order.push_back(i);
+  }
+
+  std::vector<size_t> parent(operands.size());
+  std::iota(parent.begin(), parent.end(), 0);
+  auto find = [&parent](size_t i) {
+    while (parent[i] != i) i = parent[i] = parent[parent[i]];
+    return i;
+  };
+  if (all_bounded) {
+    std::sort(order.begin(), order.end(), [&boxes](size_t a, size_t b) {
+      return boxes[a].xmin() < boxes[b].xmin();
+    });
+    std::vector<size_t> active;
+    for (size_t i : order) {
+      active.erase(std::remove_if(active.begin(), active.end(),
+                                  [&](size_t j) {
+                                    return boxes[j].xmax() < boxes[i].xmin();
+                                  }),
+                   active.end());
+      for (size_t j : active) {
+        if (CGAL::do_overlap(boxes[i], boxes[j])) parent[find(i)] = find(j);
+      }
+      active.push_back(i);
+    }
+  } else {
+    for (size_t i : order) parent[find(i)] = find(order.front());
+  }
+
+  std::vector<std::vector<size_t>> clusters;
+  std::unordered_map<size_t, size_t> cluster_of_root;
+  std::sort(order.begin(), order.end());
+  for (size_t i : order) {
+    auto [it, inserted] = cluster_of_root.emplace(find(i), clusters.size());
+    if (inserted) clusters.emplace_back();
+    clusters[it->second].push_back(i);
+  }
+
+  std::vector<CGAL_Nef_polyhedron3> cluster_nefs;
+  for (const auto &cluster : clusters) {
+    if (cluster.size() == 1) {
+      cluster_nefs.push_back(takeNef(operands[cluster.front()]));
+      continue;
+    }
+    CGAL::Nef_nary_union_3<CGAL_Nef_polyhedron3> nary_union;
+    for (size_t i : cluster) nary_union.add_polyhedron(takeNef(operands[i]));
+    cluster_nefs.push_back(nary_union.get_union());
+    s.overlays += cluster.size() - 1;
+  }
+  s.clusters = clusters.size();
+  s.skipped_overlays = clusters.empty() ? 0 : clusters.size() - 1;
+  stage.setOutputCount(s.clusters);
+
+  if (cluster_nefs.empty()) return CGAL_Nef_polyhedron3();
+  return concatenateDisjointNefs(cluster_nefs);
+}
+
+// Keeps the operands. Copying the vector only copies Nef handles, not SNCs.
+template <typename Kernel>
+CGAL::Nef_polyhedron_3<Kernel>
+unionNefs(const std::vector<CGAL::Nef_polyhedron_3<Kernel>> &operands,
+          UnionStats *stats = nullptr) {
+  return unionNefs(std::vector<CGAL::Nef_polyhedron_3<Kernel>>(operands), stats);
+}
+
+// Cheap check whether the direct Nef constructor is expected to succeed:
+// The mesh must be closed, have no non-manifold vertices, and must not
+// self-intersect. Non-manifold edges can't be represented in a Surface_mesh,
+// so those show up as dropped faces, i.e. a mesh which is not closed.
+// This runs on a double precision copy, which is exact since all our meshes
+// are built from double coordinates.
+template <typename Kernel>
+bool isNefConstructible(const Kernel_SurfaceMesh<Kernel> &mesh) {
+  namespace PMP = CGAL::Polygon_mesh_processing;
+  using SurfaceMesh = Kernel_SurfaceMesh<Kernel>;
+  ScopedStage stage("nef_precheck", mesh.number_of_faces());
+
+  if (mesh.is_empty() || !CGAL::is_closed(mesh)) return false;
+
+  std::vector<typename SurfaceMesh::Halfedge_index> non_manifold;
+  PMP::non_manifold_vertices(mesh, std::back_inserter(non_manifold));
+  if (!non_manifold.empty()) return false;
+
+  Epick_SurfaceMesh double_mesh;
+  double_mesh.reserve(mesh.number_of_vertices(), mesh.number_of_edges(),
+                      mesh.number_of_faces());
+  std::vector<Epick_SurfaceMesh::Vertex_index> vertex_map(mesh.num_vertices());
+  for (const auto v : mesh.vertices()) {
+    const auto p = toDoublePoint(mesh.point(v));
+    vertex_map[v] = double_mesh.add_vertex(Epick_Point3(p.x(), p.y(), p.z()));
+  }
+  std::vector<Epick_SurfaceMesh::Vertex_index> face_vertices;
+  for (const auto face : mesh.faces()) {
+    face_vertices.clear();
+    for (auto vd : CGAL::vertices_around_face(mesh.halfedge(face), mesh)) {
+      face_vertices.push_back(vertex_map[vd]);
+    }
+    if (double_mesh.add_face(face_vertices) == Epick_SurfaceMesh::null_face()) {
+      return false;
+    }
+  }
+  if (!CGAL::is_triangle_mesh(double_mesh)) {
+    PMP::triangulate_faces(double_mesh);
+  }
+  return !PMP::does_self_intersect(double_mesh);
+}
+
+// Strategy that produced a Nef in raceNefConstruction().
+enum class NefStrategy { None, Direct, FaceUnion };
+
+// Outcome of a raceNefConstruction() call, for the caller to report.
+struct NefRaceReport {
+  NefStrategy winner = NefStrategy::None;
+  double wall_ms = 0;
+};
+
+// Thrown by convertSurfaceMeshToNef() if nef_race_budget is set and neither
+// strategy produced a Nef within it.
+class NefBudgetExceeded : public std::runtime_error {
+public:
+  explicit NefBudgetExceeded(std::chrono::milliseconds budget)
+      : std::runtime_error("No Nef within " + std::to_string(budget.count()) +
+                           " ms") {}
+};
+
+// Shared by raceNefConstruction() and its workers. The direct constructor's
+// worker may outlive the call, so this holds its own copy of the mesh.
+template <typename Kernel> struct NefRace {
+  using CGAL_Nef_polyhedron3 = CGAL::Nef_polyhedron_3<Kernel>;
+
+  NefRace(const Kernel_SurfaceMesh<Kernel> &mesh, ProgressCallback progress)
+      : mesh(mesh), token(std::move(progress)) {}
+
+  // Called once by every worker, with a result unless it failed. The first
+  // result wins and cancels the other worker.
+  void finish(std::optional<CGAL_Nef_polyhedron3> &&nef, NefStrategy strategy) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      finished[strategy == NefStrategy::FaceUnion] = true;
+      if (nef && winner == NefStrategy::None) {
+        result = std::move(nef);
+        winner = strategy;
+        token.cancel();
+      }
+    }
+    done.notify_all();
+  }
+
+  const Kernel_SurfaceMesh<Kernel> mesh;
+  CancellationToken token;
+  std::mutex mutex;
+  std::condition_variable done;
+  std::optional<CGAL_Nef_polyhedron3> result;
+  NefStrategy winner = NefStrategy::None;
+  bool finished[2] = {false, false}; // direct, face union
+  bool direct_ran = false; // the direct constructor's timing is set
+  double direct_wall_ms = 0, direct_cpu_ms = 0;
+  size_t direct_facets = 0;
+};
+
+// If set, convertSurfaceMeshToNef() races both strategies with this budget,
+// see raceNefConstruction().
+inline std::optional<std::chrono::milliseconds> nef_race_budget;
+
+// Runs the direct Nef constructor and the face union fallback concurrently
+// and returns whichever produces a valid Nef first, so the worst case latency
+// is that of the slower strategy rather than the sum of both. The direct
+// constructor only runs if isNefConstructible() passes, and its result only
+// counts if is_valid(), as meshes near the edge of validity are what this is
+// for. Returns nothing if neither strategy succeeds within budget, or if
+// both fail.
+// The loser is cancelled: The face union stops at its next check and is
+// waited for, so it may use the pool. A running direct constructor can't be
+// interrupted. It is left to finish in the background (see abandonWorker()),
+// keeping a core busy and its copy of the mesh alive until then. It doesn't
+// touch current_metrics; its stage is recorded here if it finished in time,
+// with the CPU time of its own thread.
+// A token cancels the race like the budget does, and then Cancelled is
+// thrown. It gets the face union's progress. If report is given, it gets the
+// winner and the time the race took.
+template <typename Kernel>
+std::optional<CGAL::Nef_polyhedron_3<Kernel>>
+raceNefConstruction(const Kernel_SurfaceMesh<Kernel> &mesh,
+                    std::chrono::milliseconds budget, ThreadPool *pool = nullptr,
+                    const CancellationToken *token = nullptr,
+                    NefRaceReport *report = nullptr) {
+  using CGAL_Nef_polyhedron3 = CGAL::Nef_polyhedron_3<Kernel>;
+  CGAL::Real_timer t;
+  t.start();
+  const bool direct_possible = isNefConstructible(mesh);
+  // Forwarding to the caller's token also makes the face union throw
+  // Cancelled once that is cancelled. Only the face union calls it, and it is
+  // joined before returning, so token outlives every call.
+  ProgressCallback progress;
+  if (token) {
+    progress = [token](const char *stage, size_t done, size_t total) {
+      token->checkpoint(stage, done, total);
+    };
+  }
+  auto race = std::make_shared<NefRace<Kernel>>(mesh, std::move(progress));
+
+  std::thread direct([race, direct_possible] {
+    std::optional<CGAL_Nef_polyhedron3> nef;
+    if (direct_possible && !race->token.cancelled()) {
+      CGAL::Real_timer wall;
+      wall.start();
+      const double cpu_start = threadCpuMs();
+      try {
+        nef.emplace(race->mesh);
+        if (!nef->is_valid()) nef.reset();
+      } catch (const CGAL::Assertion_exception &) {
+        nef.reset();
+      }
+      wall.stop();
+      const double cpu_ms = threadCpuMs() - cpu_start;
+      std::lock_guard<std::mutex> lock(race->mutex);
+      race->direct_ran = true;
+      race->direct_wall_ms = wall.time() * 1000;
+      race->direct_cpu_ms = cpu_ms;
+      race->direct_facets = nef ? nef->number_of_facets() : 0;
+    }
+    race->finish(std::move(nef), NefStrategy::Direct);
+  });
+  std::thread face_union([race, pool, parent = current_stage] {
+    StageParent stage_parent(parent);
+    std::optional<CGAL_Nef_polyhedron3> nef;
+    try {
+      nef = pool ? unionMeshFacesToNef(race->mesh, *pool, true, &race->token)
+                 : unionMeshFacesToNef(race->mesh, true, &race->token);
+    } catch (const Cancelled &) {
+    }
+    race->finish(std::move(nef), NefStrategy::FaceUnion);
+  });
+
+  // The caller's token can't notify, so it is polled.
+  const auto deadline = std::chrono::steady_clock::now() + budget;
+  std::unique_lock<std::mutex> lock(race->mutex);
+  while (race->winner == NefStrategy::None &&
+         !(race->finished[0] && race->finished[1]) &&
+         !(token && token->cancelled()) &&
+         std::chrono::steady_clock::now() < deadline) {
+    const auto poll = std::chrono::steady_clock::now() + std::chrono::milliseconds(20);
+    race->done.wait_until(lock, std::min(deadline, poll));
+  }
+  race->token.cancel();
+  lock.unlock();
+
+  face_union.join();
+  lock.lock();
+  std::optional<CGAL_Nef_polyhedron3> result = std::move(race->result);
+  const NefStrategy strategy = race->winner;
+  const bool direct_finished = race->finished[0];
+  if (direct_finished && race->direct_ran && current_metrics) {
+    current_metrics->record("nef_construction", race->direct_wall_ms,
+                            race->direct_cpu_ms, mesh.number_of_faces(),
+                            race->direct_facets);
+  }
+  lock.unlock();
+  if (direct_finished) {
+    direct.join();
+  } else {
+    abandonWorker(std::move(direct));
+  }
+  t.stop();
+  throwIfCancelled(token);
+
+  if (report) *report = {strategy, t.time() * 1000};
+  return result;
+}
+
+// If a pool is given, the face union fallback runs in parallel. If
+// nef_race_budget is set, both strategies run concurrently instead, and
+// NefBudgetExceeded is thrown if neither finishes within it; race_report then
+// gets the outcome, see raceNefConstruction().
+// A token is checked around the direct construction, which can't be
+// interrupted, and is passed on to the face union and the race; see
+// CancellationToken.
+template <typename Kernel>
+CGAL::Nef_polyhedron_3<Kernel>
+convertSurfaceMeshToNef(const Kernel_SurfaceMesh<Kernel> &mesh,
+                        ThreadPool *pool = nullptr,
+                        const CancellationToken *token = nullptr,
+                        NefRaceReport *race_report = nullptr) {
+  using CGAL_Nef_polyhedron3 = CGAL::Nef_polyhedron_3<Kernel>;
+  // Note: The Nef constructor may cause a CGAL exception if the input mesh is
   // self-intersecting: If a very thin part of an object collapses into one
   // floating point coordinate, but the vertices are still distinct, it's
   // considered a self-intersection. This is valid in e.g. Manifold, but invalid
   // in SurfaceMesh -> Nef.
-  // If this happens, we fall back to unioning all faces, which is slower but more
-  // robust.
-  try {
-    CGAL_Nef_polyhedron3 touching_cubes_nef(mesh);
-    writeNef(touching_cubes_nef, "third.nef3");
-    printStats(touching_cubes_nef, "third");
-    return touching_cubes_nef;
-  } catch (const CGAL::Assertion_exception &e) {
-    std::cerr
-        << "Warning: CGAL error in CGAL_Nef_polyhedron3(): Attempting union..."
-        << std::endl;
-    return unionMeshFacesToNef(mesh);
+  // In that case, we use the union of all faces, which is slower but more
+  // robust. isNefConstructible() picks the strategy up front, so bad inputs
+  // don't pay for a failed exact construction first. The exception handler
+  // stays as a safety net.
+  if (nef_race_budget) {
+    auto nef =
+        raceNefConstruction(mesh, *nef_race_budget, pool, token, race_report);
+    if (!nef) throw NefBudgetExceeded(*nef_race_budget);
+    return std::move(*nef);
+  }
+
+  checkpoint(token, "nef_precheck", 0, 1);
+  CGAL::Real_timer t;
+  t.start();
+  const bool direct = isNefConstructible(mesh);
+  t.stop();
+  std::cout << "Nef pre-check: " << t.time() * 1000 << " ms, using "
+            << (direct ? "direct construction" : "face union") << std::endl;
+
+  if (direct) {
+    t.reset();
+    t.start();
+    checkpoint(token, "nef_construction", 0, 1);
+    try {
+      ScopedStage stage("nef_construction", mesh.number_of_faces());
+      CGAL_Nef_polyhedron3 nef(mesh);
+      stage.setOutputCount(nef.number_of_facets());
+      t.stop();
+      checkpoint(token, "nef_construction", 1, 1);
+      std::cout << "Direct Nef construction: " << t.time() * 1000 << " ms"
+                << std::endl;
+      return nef;
+    } catch (const CGAL::Assertion_exception &e) {
+      t.stop();
+      std::cerr << "Warning: CGAL error in CGAL_Nef_polyhedron3() after "
+                << t.time() * 1000 << " ms: Attempting union..." << std::endl;
+    }
   }
+
+  t.reset();
+  t.start();
+  CGAL_Nef_polyhedron3 nef_union =
+      pool ? unionMeshFacesToNef(mesh, *pool, true, token)
+           : unionMeshFacesToNef(mesh, true, token);
+  t.stop();
+  std::cout << "Face union: " << t.time() * 1000 << " ms" << std::endl;
+  return nef_union;
 }
 
-std::vector<std::vector<Double_Point3>>
-decompose(CGAL_Nef_polyhedron3 &nef, bool use_shell_exploration = false) {
-  CGAL::convex_decomposition_3(nef);
-  printStats(nef, "decomposed sum_nef");
+// Splits mesh into its connected components, where faces sharing a vertex
+// are connected. Linear in the mesh size (union-find over the vertices).
+template <typename Kernel>
+std::vector<Kernel_SurfaceMesh<Kernel>>
+splitConnectedComponents(const Kernel_SurfaceMesh<Kernel> &mesh) {
+  using SurfaceMesh = Kernel_SurfaceMesh<Kernel>;
+  std::vector<uint32_t> parent(mesh.num_vertices());
+  std::iota(parent.begin(), parent.end(), 0);
+  auto find = [&parent](uint32_t i) {
+    while (parent[i] != i) i = parent[i] = parent[parent[i]];
+    return i;
+  };
+  for (const auto face : mesh.faces()) {
+    const uint32_t first = mesh.target(mesh.halfedge(face));
+    for (auto vd : CGAL::vertices_around_face(mesh.halfedge(face), mesh)) {
+      parent[find(vd)] = find(first);
+    }
+  }
 
-  std::vector<std::vector<Double_Point3>> parts;
-  int num_parts = 0;
-  int num_unmarked = 0;
-  auto ci = nef.volumes_begin();
-  for (; ci != nef.volumes_end(); ++ci) {
-    if (ci->mark()) {
-      // Two ways of extracting points:
-      // 1. The usual Nef -> Polyhedron_3 -> points
-      // 2. Direct Nef -> points using a shell explorer visitor
-
-      if (!use_shell_exploration) {
-        // Method 1: Nef -> Polyhedron_3 -> points
-        CGAL::Polyhedron_3<CGAL_Kernel3> P;
-        nef.convert_inner_shell_to_polyhedron(ci->shells_begin(), P);
-
-        CGAL::Cartesian_converter<CGAL_Kernel3, Double_Kernel> conv;
-        auto &out = parts.emplace_back();
-        out.reserve(P.size_of_vertices());
-        for (auto pi = P.vertices_begin(); pi != P.vertices_end(); ++pi) {
-          out.push_back(conv(pi->point()));
-        }
-        std::cout << "Part " << num_parts << ": " << out.size() << " vertices"
-                  << std::endl;
-      } else {
-        auto &out = parts.emplace_back();
-        class Add_vertices {
+  std::vector<SurfaceMesh> components;
+  std::vector<int32_t> component_of_root(parent.size(), -1);
+  std::vector<typename SurfaceMesh::Vertex_index> vertex_map(parent.size());
+  for (const auto v : mesh.vertices()) {
+    if (mesh.is_isolated(v)) continue;
+    int32_t &component = component_of_root[find(v)];
+    if (component < 0) {
+      component = components.size();
+      components.emplace_back();
+    }
+    vertex_map[v] = components[component].add_vertex(mesh.point(v));
+  }
+  std::vector<typename SurfaceMesh::Vertex_index> face_vertices;
+  for (const auto face : mesh.faces()) {
+    face_vertices.clear();
+    for (auto vd : CGAL::vertices_around_face(mesh.halfedge(face), mesh)) {
+      face_vertices.push_back(vertex_map[vd]);
+    }
+    const uint32_t root = find(mesh.target(mesh.halfedge(face)));
+    components[component_of_root[root]].add_face(face_vertices);
+  }
+  return components;
+}
 
-          std::vector<Double_Point3> &out_;
-          CGAL::Cartesian_converter<CGAL_Kernel3, Double_Kernel> conv_;
+// Whether building components separately could change the point set: A
+// component with negative signed volume bounds a cavity (or is inverted), and
+// a component whose bounding box contains another one's may enclose it. In a
+// single Nef, a cavity stays empty. Unioned as separate Nefs, it gets filled
+// by the component around it.
+template <typename Kernel>
+bool componentsMayNest(const std::vector<Kernel_SurfaceMesh<Kernel>> &components) {
+  std::vector<CGAL::Bbox_3> boxes;
+  for (const auto &component : components) {
+    CGAL::Bbox_3 &box = boxes.emplace_back();
+    double volume = 0; // six times the signed volume
+    std::vector<Double_Point3> polygon;
+    for (const auto face : component.faces()) {
+      polygon.clear();
+      for (auto vd : CGAL::vertices_around_face(component.halfedge(face), component)) {
+        polygon.push_back(toDoublePoint(component.point(vd)));
+        box += polygon.back().bbox();
+      }
+      for (size_t i = 1; i + 1 < polygon.size(); ++i) {
+        volume += CGAL::scalar_product(
+            polygon[0] - CGAL::ORIGIN,
+            CGAL::cross_product(polygon[i] - CGAL::ORIGIN,
+                                polygon[i + 1] - CGAL::ORIGIN));
+      }
+    }
+    if (volume < 0) return true;
+  }
+  auto contains = [](const CGAL::Bbox_3 &a, const CGAL::Bbox_3 &b) {
+    return a.xmin() <= b.xmin() && a.ymin() <= b.ymin() && a.zmin() <= b.zmin() &&
+           a.xmax() >= b.xmax() && a.ymax() >= b.ymax() && a.zmax() >= b.zmax();
+  };
+  for (size_t i = 0; i < boxes.size(); ++i) {
+    for (size_t j = 0; j < boxes.size(); ++j) {
+      if (i != j && contains(boxes[i], boxes[j])) return true;
+    }
+  }
+  return false;
+}
 
-        public:
-          Add_vertices(std::vector<Double_Point3> &out) : out_(out) {}
+// Builds one Nef per mesh and unions them with unionNefs(), which only
+// overlays meshes whose bounding boxes overlap. A mesh that fails the
+// pre-check or throws falls back to the face union on its own. With a pool,
+// the meshes are built concurrently. The meshes must not bound cavities of
+// each other, see componentsMayNest(). A token is checked before every
+// component and passed on to the fallback; the final union can't be
+// interrupted.
+template <typename Kernel>
+CGAL::Nef_polyhedron_3<Kernel>
+convertComponentsToNef(const std::vector<Kernel_SurfaceMesh<Kernel>> &components,
+                       ThreadPool *pool = nullptr,
+                       const CancellationToken *token = nullptr) {
+  using CGAL_Nef_polyhedron3 = CGAL::Nef_polyhedron_3<Kernel>;
+  CGAL::Real_timer t;
+  t.start();
+  std::vector<CGAL_Nef_polyhedron3> nefs(components.size());
+  std::vector<char> fell_back(components.size(), false);
+  std::atomic<size_t> num_built{0};
+  // The pool isn't reentrant, so fallback unions run sequentially within
+  // their component's task.
+  const char *parent = current_stage;
+  auto build = [&](size_t i) {
+    StageParent stage_parent(parent);
+    checkpoint(token, "nef_construction", num_built++, components.size());
+    const auto &component = components[i];
+    if (isNefConstructible(component)) {
+      try {
+        ScopedStage stage("nef_construction", component.number_of_faces());
+        nefs[i] = CGAL_Nef_polyhedron3(component);
+        stage.setOutputCount(nefs[i].number_of_facets());
+        return;
+      } catch (const CGAL::Assertion_exception &) {
+      }
+    }
+    nefs[i] = unionMeshFacesToNef(component, true, token);
+    fell_back[i] = true;
+  };
+  if (pool) {
+    pool->parallel_for(components.size(), build);
+  } else {
+    for (size_t i = 0; i < components.size(); ++i) build(i);
+  }
 
-          void visit(CGAL_Nef_polyhedron3::Vertex_const_handle v) {
-            out_.push_back(conv_(v->point()));
-          }
+  UnionStats union_stats;
+  CGAL_Nef_polyhedron3 nef = unionNefs(std::move(nefs), &union_stats);
+  t.stop();
+  std::cout << "Per-component Nef construction: " << components.size()
+            << " components ("
+            << std::count(fell_back.begin(), fell_back.end(), true)
+            << " via face union), " << union_stats.skipped_overlays
+            << " overlays skipped, " << t.time() * 1000 << " ms" << std::endl;
+  return nef;
+}
 
-          void visit(CGAL_Nef_polyhedron3::Halffacet_const_handle) {}
-          void visit(CGAL_Nef_polyhedron3::SFace_const_handle) {}
-          void visit(CGAL_Nef_polyhedron3::Halfedge_const_handle) {}
-          void visit(CGAL_Nef_polyhedron3::SHalfedge_const_handle) {}
-          void visit(CGAL_Nef_polyhedron3::SHalfloop_const_handle) {}
-        };
+// Per-component variant of convertSurfaceMeshToNef(): Every connected
+// component gets its own Nef, built concurrently on the pool, see
+// convertComponentsToNef(). Meshes with cavities, or components that may be
+// nested, are built as a whole instead. A token is passed on.
+template <typename Kernel>
+CGAL::Nef_polyhedron_3<Kernel>
+convertSurfaceMeshToNefByComponent(const Kernel_SurfaceMesh<Kernel> &mesh,
+                                   ThreadPool &pool,
+                                   const CancellationToken *token = nullptr) {
+  const auto components = splitConnectedComponents(mesh);
+  if (components.size() <= 1) {
+    return convertSurfaceMeshToNef(mesh, &pool, token);
+  }
+  if (componentsMayNest(components)) {
+    std::cout << "Per-component Nef construction: components may be nested, "
+                 "building the whole mesh"
+              << std::endl;
+    return convertSurfaceMeshToNef(mesh, &pool, token);
+  }
+  return convertComponentsToNef(components, &pool, token);
+}
+
+// Splits a triangle soup into its vertex-connected parts. Unused vertices are
+// dropped. After splitNonManifold(), these are its shells.
+inline std::vector<Object> splitObjectShells(const Object &obj) {
+  std::vector<uint32_t> parent(obj.vertices.size());
+  std::iota(parent.begin(), parent.end(), 0);
+  auto find = [&parent](uint32_t i) {
+    while (parent[i] != i) i = parent[i] = parent[parent[i]];
+    return i;
+  };
+  for (const auto &f : obj.indices) {
+    parent[find(f[1])] = find(f[0]);
+    parent[find(f[2])] = find(f[0]);
+  }
+
+  std::vector<Object> shells;
+  std::vector<uint32_t> shell_of_root(obj.vertices.size(), no_mate);
+  std::vector<uint32_t> index_in_shell(obj.vertices.size(), no_mate);
+  for (const auto &f : obj.indices) {
+    uint32_t &shell = shell_of_root[find(f[0])];
+    if (shell == no_mate) {
+      shell = shells.size();
+      shells.emplace_back();
+    }
+    Object &out = shells[shell];
+    std::array<uint32_t, 3> face;
+    for (int k = 0; k < 3; ++k) {
+      if (index_in_shell[f[k]] == no_mate) {
+        index_in_shell[f[k]] = out.vertices.size();
+        out.vertices.push_back(obj.vertices[f[k]]);
+      }
+      face[k] = index_in_shell[f[k]];
+    }
+    out.indices.push_back(face);
+  }
+  return shells;
+}
+
+// Builds a Nef polyhedron straight from a triangle soup with NefSoupBuilder,
+// i.e. without a Surface_mesh and without a Nef per facet. Closed shells
+// bound solids. Open shells are kept as surfaces, and then every bounded
+// volume is marked, which gives the same point set as the face union.
+// Returns nothing if the soup is not manifold, self-intersects or has
+// degenerate faces; splitNonManifold() and a union of the shells handle the
+// first case, see convertObjectToNef().
+template <typename Kernel = CGAL_Kernel3>
+std::optional<CGAL::Nef_polyhedron_3<Kernel>> buildNefFromSoup(const Object &soup) {
+  namespace PMP = CGAL::Polygon_mesh_processing;
+  using CGAL_Nef_polyhedron3 = CGAL::Nef_polyhedron_3<Kernel>;
+  ScopedStage stage("soup_build", soup.indices.size());
+  if (soup.indices.empty()) return CGAL_Nef_polyhedron3();
+
+  ManifoldStats stats;
+  splitNonManifold(soup, &stats);
+  if (!stats.isManifold()) return std::nullopt;
+
+  std::vector<Epick_Point3> double_points;
+  double_points.reserve(soup.vertices.size());
+  for (const auto &v : soup.vertices) double_points.emplace_back(v[0], v[1], v[2]);
+  for (const auto &f : soup.indices) {
+    if (CGAL::collinear(double_points[f[0]], double_points[f[1]],
+                        double_points[f[2]])) {
+      return std::nullopt;
+    }
+  }
+  if (PMP::does_triangle_soup_self_intersect(double_points, soup.indices)) {
+    return std::nullopt;
+  }
+
+  std::vector<uint32_t> mate;
+  size_t boundary_edges, non_manifold_edges;
+  pairHalfedges(soup.indices, mate, boundary_edges, non_manifold_edges);
+
+  // A face is solid if its shell has no border.
+  std::vector<uint32_t> parent(soup.indices.size());
+  std::iota(parent.begin(), parent.end(), 0);
+  auto find = [&parent](uint32_t i) {
+    while (parent[i] != i) i = parent[i] = parent[parent[i]];
+    return i;
+  };
+  for (uint32_t h = 0; h < mate.size(); ++h) {
+    if (mate[h] != no_mate) parent[find(h / 3)] = find(mate[h] / 3);
+  }
+  std::vector<char> solid(soup.indices.size(), true);
+  for (uint32_t h = 0; h < mate.size(); ++h) {
+    if (mate[h] == no_mate) solid[find(h / 3)] = false;
+  }
+  for (uint32_t f = 0; f < solid.size(); ++f) solid[f] = solid[find(f)];
+
+  std::vector<typename CGAL_Nef_polyhedron3::Point_3> points;
+  points.reserve(soup.vertices.size());
+  for (const auto &v : soup.vertices) points.push_back(toExactPoint<Kernel>(v));
+
+  CGAL_Nef_polyhedron3 nef =
+      NefSoupBuilder<CGAL_Nef_polyhedron3>(points, soup.indices, mate, solid);
+  if (boundary_edges > 0) {
+    CGAL::Mark_bounded_volumes<CGAL_Nef_polyhedron3> mbv(true);
+    nef.delegate(mbv);
+  }
+  stage.setOutputCount(nef.number_of_facets());
+  return nef;
+}
+
+// Converts a triangle soup to a Nef polyhedron. Non-manifold edges can't be
+// represented in a Surface_mesh, and non-manifold vertices make the direct
+// Nef constructor fail, so either used to mean the slow face union fallback.
+// Manifold soups are built directly by buildNefFromSoup(). Otherwise,
+// splitNonManifold() runs first: If splitting yields outward oriented shells,
+// e.g. solids touching along an edge or at a vertex, each shell is built
+// directly and the shells are unioned. Soups that can't be built directly
+// (self-intersections, or cavities next to non-manifold features) go through
+// convertSurfaceMeshToNef(). A token is checked before every shell and passed
+// on to convertSurfaceMeshToNef().
+template <typename Kernel = CGAL_Kernel3>
+CGAL::Nef_polyhedron_3<Kernel>
+convertObjectToNef(const Object &obj, ThreadPool *pool = nullptr,
+                   const CancellationToken *token = nullptr) {
+  using CGAL_Nef_polyhedron3 = CGAL::Nef_polyhedron_3<Kernel>;
+  ManifoldStats stats;
+  const Object split = splitNonManifold(obj, &stats);
+  std::cout << "Manifold pre-pass: " << stats.non_manifold_edges
+            << " non-manifold edges, " << stats.non_manifold_vertices
+            << " non-manifold vertices, " << stats.shells << " shells ("
+            << (stats.closed ? "closed" : "open") << ")" << std::endl;
+  if (stats.isManifold()) {
+    if (auto nef = buildNefFromSoup<Kernel>(obj)) return std::move(*nef);
+  } else if (stats.inverted_shells == 0) {
+    // Touching shells share points but no vertices, so each needs its own
+    // Nef. Volumes enclosed by several open shells only show up in the union.
+    const std::vector<Object> shells = splitObjectShells(split);
+    std::vector<std::optional<CGAL_Nef_polyhedron3>> built(shells.size());
+    std::atomic<size_t> num_built{0};
+    const char *parent = current_stage;
+    auto build = [&](size_t i) {
+      StageParent stage_parent(parent);
+      checkpoint(token, "soup_build", num_built++, shells.size());
+      built[i] = buildNefFromSoup<Kernel>(shells[i]);
+    };
+    if (pool) {
+      pool->parallel_for(shells.size(), build);
+    } else {
+      for (size_t i = 0; i < shells.size(); ++i) build(i);
+    }
+    if (std::all_of(built.begin(), built.end(),
+                    [](const auto &nef) { return nef.has_value(); })) {
+      std::vector<CGAL_Nef_polyhedron3> nefs;
+      nefs.reserve(built.size());
+      for (auto &nef : built) nefs.push_back(takeNef(*nef));
+      CGAL_Nef_polyhedron3 nef = unionNefs(std::move(nefs));
+      if (!stats.closed) {
+        CGAL::Mark_bounded_volumes<CGAL_Nef_polyhedron3> mbv(true);
+        nef.delegate(mbv);
+      }
+      return nef;
+    }
+  }
+  std::cout << "Direct soup build not possible, building a mesh" << std::endl;
+  return convertSurfaceMeshToNef(createSurfaceMesh<Kernel>(obj), pool, token);
+}
+
+// Checks whether nef is a single convex solid without voids or lower
+// dimensional features, and if so converts its boundary into P. The test is
+// exact: after triangulating, no edge may be reflex (flat edges are fine).
+// A closed connected surface without reflex edges bounds a convex solid.
+// convert_inner_shell_to_polyhedron() orients P outwards, so a reflex edge
+// has the far vertex of its second facet above the plane of its first one;
+// test_nef checks this on a convex and a non-convex input.
+// Inputs that are not a single solid, e.g. several parts, are rejected by
+// counting volumes and shells, before the linear is_simple() and conversion.
+template <typename Kernel>
+bool isConvexNef(CGAL::Nef_polyhedron_3<Kernel> &nef,
+                 CGAL::Polyhedron_3<Kernel> &P) {
+  ScopedStage stage("convexity_check", nef.number_of_facets());
+  if (nef.number_of_volumes() != 2) return false;
+  // Exactly one marked volume, and it's not the outer one.
+  auto outer = nef.volumes_begin();
+  auto volume = std::next(outer);
+  if (outer->mark() || !volume->mark() ||
+      std::distance(volume->shells_begin(), volume->shells_end()) != 1) {
+    return false;
+  }
+  if (!nef.is_simple()) return false;
+  nef.convert_inner_shell_to_polyhedron(volume->shells_begin(), P);
+  if (!CGAL::is_triangle_mesh(P)) {
+    CGAL::Polygon_mesh_processing::triangulate_faces(P);
+  }
+  for (auto e = P.edges_begin(); e != P.edges_end(); ++e) {
+    const auto &p = e->opposite()->vertex()->point();
+    const auto &q = e->vertex()->point();
+    const auto &r = e->next()->vertex()->point();
+    const auto &s = e->opposite()->next()->vertex()->point();
+    if (CGAL::orientation(p, q, r, s) == CGAL::POSITIVE) return false;
+  }
+  stage.setOutputCount(1);
+  return true;
+}
+
+// How decompose_to_sink() extracts the points of each convex part.
+enum class PartExtraction {
+  Polyhedron,       // convert_inner_shell_to_polyhedron(), then its vertices
+  ShellExploration, // visit_shell_objects() directly on the Nef
+  Automatic,        // per part by its size, see shell_exploration_min_vertices
+};
+
+// Part size from which PartExtraction::Automatic uses shell exploration for a
+// part. Small parts are cheaper to convert to a Polyhedron_3 than to explore
+// with the visitor's hash maps. bench_extraction times both strategies per
+// part size on a given Nef and prints the size from which exploration wins;
+// set this to that.
+inline size_t shell_exploration_min_vertices = 32;
+
+// Size of every volume of nef, keyed by its address: the number of sfaces
+// inside it, which for a convex part is its number of vertices. One pass over
+// the sphere maps, so the size of each part is known before extracting it.
+template <typename Kernel>
+std::unordered_map<const void *, size_t>
+volumeSizes(const CGAL::Nef_polyhedron_3<Kernel> &nef) {
+  const auto &snc = NefAccess<CGAL::Nef_polyhedron_3<Kernel>>::structure(nef);
+  std::unordered_map<const void *, size_t> sizes;
+  for (auto sf = snc.sfaces_begin(); sf != snc.sfaces_end(); ++sf) {
+    sizes[&*sf->volume()]++;
+  }
+  return sizes;
+}
+
+// Points of the convex part bounded by the first shell of volume.
+template <typename Kernel, typename VolumeIterator>
+std::vector<Double_Point3> extractPart(CGAL::Nef_polyhedron_3<Kernel> &nef,
+                                       VolumeIterator volume,
+                                       bool use_shell_exploration) {
+  using CGAL_Nef_polyhedron3 = CGAL::Nef_polyhedron_3<Kernel>;
+  std::vector<Double_Point3> out;
+  if (!use_shell_exploration) {
+    CGAL::Polyhedron_3<Kernel> P;
+    nef.convert_inner_shell_to_polyhedron(volume->shells_begin(), P);
+    out.reserve(P.size_of_vertices());
+    for (auto pi = P.vertices_begin(); pi != P.vertices_end(); ++pi) {
+      out.push_back(toDoublePoint(pi->point()));
+    }
+    return out;
+  }
+  // Vertices are deduplicated by handle before the conversion to double, so
+  // neither the conversion nor the hull sees a vertex twice. Distinct Nef
+  // vertices have distinct points.
+  class Add_vertices {
+
+    std::vector<Double_Point3> &out_;
+    std::unordered_set<const void *> seen_;
+
+  public:
+    Add_vertices(std::vector<Double_Point3> &out) : out_(out) {}
 
-        Add_vertices A(out);
-        nef.visit_shell_objects(ci->shells_begin(), A);
-        std::cout << "Part " << num_parts << ": " << out.size() << " vertices "
+    void visit(typename CGAL_Nef_polyhedron3::Vertex_const_handle v) {
+      if (seen_.insert(&*v).second) {
+        out_.push_back(toDoublePoint(v->point()));
+      }
+    }
+
+    void visit(typename CGAL_Nef_polyhedron3::Halffacet_const_handle) {}
+    void visit(typename CGAL_Nef_polyhedron3::SFace_const_handle) {}
+    void visit(typename CGAL_Nef_polyhedron3::Halfedge_const_handle) {}
+    void visit(typename CGAL_Nef_polyhedron3::SHalfedge_const_handle) {}
+    void visit(typename CGAL_Nef_polyhedron3::SHalfloop_const_handle) {}
+  };
+
+  Add_vertices A(out);
+  nef.visit_shell_objects(volume->shells_begin(), A);
+  return out;
+}
+
+// Decomposes nef in place into convex parts and passes the points of each
+// part to sink(std::vector<Double_Point3> &&) as soon as it is extracted, so
+// hulling or export can start without holding all parts in memory.
+// Per-part logging and the decomposed Nef's stats are printed only if verbose.
+// Convex input is passed on as the single part without decomposing.
+// If nef shares its SNC with another copy, the decomposition clones it first;
+// the rvalue overload below avoids that.
+// A token is checked around convex_decomposition_3(), which can't be
+// interrupted, and before every volume. Cancelling leaves nef decomposed, and
+// the sink has received the parts extracted so far.
+template <typename Kernel, typename PartSink>
+void decompose_to_sink(CGAL::Nef_polyhedron_3<Kernel> &nef, PartSink &&sink,
+                       PartExtraction extraction = PartExtraction::Automatic,
+                       bool verbose = false,
+                       const CancellationToken *token = nullptr) {
+  checkpoint(token, "convexity_check", 0, 1);
+  {
+    CGAL::Polyhedron_3<Kernel> P;
+    if (isConvexNef(nef, P)) {
+      std::vector<Double_Point3> out;
+      out.reserve(P.size_of_vertices());
+      for (auto pi = P.vertices_begin(); pi != P.vertices_end(); ++pi) {
+        out.push_back(toDoublePoint(pi->point()));
+      }
+      if (verbose) {
+        std::cout << "Input is convex, skipping decomposition" << std::endl;
+        std::cout << "Part 0: " << out.size() << " vertices" << std::endl;
+        std::cout << "Number of parts: 1" << std::endl;
+      }
+      sink(std::move(out));
+      return;
+    }
+  }
+  checkpoint(token, "convex_decomposition", 0, 1);
+  {
+    ScopedStage stage("convex_decomposition", nef.number_of_volumes());
+    CGAL::convex_decomposition_3(nef);
+    stage.setOutputCount(nef.number_of_volumes());
+  }
+  checkpoint(token, "convex_decomposition", 1, 1);
+  if (verbose) printStats(nef, "decomposed sum_nef");
+
+  std::unordered_map<const void *, size_t> sizes;
+  if (extraction == PartExtraction::Automatic) sizes = volumeSizes(nef);
+
+  int num_parts = 0;
+  int num_unmarked = 0;
+  size_t num_explored = 0;
+  const size_t num_volumes = nef.number_of_volumes();
+  auto ci = nef.volumes_begin();
+  for (size_t volume = 0; ci != nef.volumes_end(); ++ci, ++volume) {
+    checkpoint(token, "extraction", volume, num_volumes);
+    if (ci->mark()) {
+      const bool use_shell_exploration =
+          extraction == PartExtraction::ShellExploration ||
+          (extraction == PartExtraction::Automatic &&
+           sizes[&*ci] >= shell_exploration_min_vertices);
+      num_explored += use_shell_exploration;
+      std::vector<Double_Point3> out;
+      {
+        ScopedStage stage("extraction", 1);
+        out = extractPart(nef, ci, use_shell_exploration);
+        stage.setOutputCount(out.size());
+      }
+      if (verbose) {
+        std::cout << "Part " << num_parts << ": " << out.size() << " vertices"
                   << std::endl;
       }
+      sink(std::move(out));
       num_parts++;
     } else {
       num_unmarked++;
     }
   }
 
-  std::cout << "Number of parts: " << num_parts << std::endl;
-  std::cout << "Number of unmarked parts: " << num_unmarked << std::endl;
+  checkpoint(token, "extraction", num_volumes, num_volumes);
+
+  if (verbose) {
+    std::cout << "Number of parts: " << num_parts << std::endl;
+    std::cout << "Number of unmarked parts: " << num_unmarked << std::endl;
+    std::cout << "Extracted " << num_explored
+              << " parts via shell exploration, the others via Polyhedron_3"
+              << std::endl;
+  }
+}
+
+// Consuming variant of decompose_to_sink(): Takes ownership of nef's SNC,
+// decomposes it without copying, and frees it before returning. To keep the
+// original, pass an explicit copy, e.g. CGAL::Nef_polyhedron_3<Kernel>(nef).
+template <typename Kernel, typename PartSink>
+void decompose_to_sink(CGAL::Nef_polyhedron_3<Kernel> &&nef, PartSink &&sink,
+                       PartExtraction extraction = PartExtraction::Automatic,
+                       bool verbose = false,
+                       const CancellationToken *token = nullptr) {
+  CGAL::Nef_polyhedron_3<Kernel> owned = takeNef(nef);
+  decompose_to_sink(owned, std::forward<PartSink>(sink), extraction, verbose,
+                    token);
+}
+
+template <typename Kernel>
+std::vector<std::vector<Double_Point3>>
+decompose(CGAL::Nef_polyhedron_3<Kernel> &nef,
+          PartExtraction extraction = PartExtraction::Automatic,
+          const CancellationToken *token = nullptr) {
+  std::vector<std::vector<Double_Point3>> parts;
+  decompose_to_sink(
+      nef,
+      [&parts](std::vector<Double_Point3> &&part) {
+        parts.push_back(std::move(part));
+      },
+      extraction, /*verbose=*/true, token);
   return parts;
 }
 
-std::vector<CGAL::Surface_mesh<Double_Point3>>
-hull_parts(std::vector<std::vector<Double_Point3>> &parts) {
-  std::vector<CGAL::Surface_mesh<Double_Point3>> meshes;
-  for (auto &part : parts) {
+// Consuming variant of decompose(), see the rvalue decompose_to_sink().
+template <typename Kernel>
+std::vector<std::vector<Double_Point3>>
+decompose(CGAL::Nef_polyhedron_3<Kernel> &&nef,
+          PartExtraction extraction = PartExtraction::Automatic,
+          const CancellationToken *token = nullptr) {
+  CGAL::Nef_polyhedron_3<Kernel> owned = takeNef(nef);
+  return decompose(owned, extraction, token);
+}
+
+// Parallel variant of decompose(): Cuts nef into num_slabs slabs of equal
+// width along the longest axis of its bounding box, by intersecting it with
+// boxes, and decomposes the slabs concurrently on the pool. The parts are
+// returned slab by slab. Cutting adds parts; mergeConvexParts() can join
+// those again. nef itself is only read, by all tasks concurrently; that is
+// safe because cgal_tools.h requires CGAL_HAS_THREADS.
+// A token is checked before every slab, and progress counts slabs.
+template <typename Kernel>
+std::vector<std::vector<Double_Point3>>
+decomposeBySlabs(const CGAL::Nef_polyhedron_3<Kernel> &nef, size_t num_slabs,
+                 ThreadPool &pool,
+                 PartExtraction extraction = PartExtraction::Automatic,
+                 const CancellationToken *token = nullptr) {
+  using CGAL_Nef_polyhedron3 = CGAL::Nef_polyhedron_3<Kernel>;
+  if (num_slabs <= 1 || nef.is_empty()) {
+    return decompose(CGAL_Nef_polyhedron3(nef), extraction, token);
+  }
+  ScopedStage stage("slab_decomposition", num_slabs);
+
+  CGAL::Bbox_3 bbox;
+  for (auto v = nef.vertices_begin(); v != nef.vertices_end(); ++v) {
+    bbox += v->point().bbox();
+  }
+  int axis = 0;
+  for (int i = 1; i < 3; ++i) {
+    if (bbox.max(i) - bbox.min(i) > bbox.max(axis) - bbox.min(axis)) axis = i;
+  }
+  const double min = bbox.min(axis), width = bbox.max(axis) - min;
+  // Each slab is intersected with a box that extends beyond the bounding box
+  // on all other sides. Cuts are at doubles, which convert exactly to every
+  // kernel.
+  auto slabBox = [&](size_t i) {
+    const double margin = 1 + std::max({bbox.xmax() - bbox.xmin(),
+                                        bbox.ymax() - bbox.ymin(),
+                                        bbox.zmax() - bbox.zmin()});
+    DoubleVertex lo, hi;
+    for (int k = 0; k < 3; ++k) {
+      lo[k] = bbox.min(k) - margin;
+      hi[k] = bbox.max(k) + margin;
+    }
+    if (i > 0) lo[axis] = min + width * i / num_slabs;
+    if (i + 1 < num_slabs) hi[axis] = min + width * (i + 1) / num_slabs;
+    return CGAL_Nef_polyhedron3(createSurfaceMesh<Kernel>(boxObject(lo, hi)));
+  };
+
+  std::vector<std::vector<std::vector<Double_Point3>>> slab_parts(num_slabs);
+  std::atomic<size_t> num_done{0};
+  pool.parallel_for(num_slabs, [&, parent = current_stage](size_t i) {
+    StageParent stage_parent(parent);
+    checkpoint(token, "slab_decomposition", num_done++, num_slabs);
+    CGAL_Nef_polyhedron3 slab = (nef * slabBox(i)).regularization();
+    decompose_to_sink(
+        std::move(slab),
+        [&parts = slab_parts[i]](std::vector<Double_Point3> &&part) {
+          parts.push_back(std::move(part));
+        },
+        extraction);
+  });
+
+  checkpoint(token, "slab_decomposition", num_slabs, num_slabs);
+
+  std::vector<std::vector<Double_Point3>> parts;
+  for (auto &slab : slab_parts) {
+    std::move(slab.begin(), slab.end(), std::back_inserter(parts));
+  }
+  stage.setOutputCount(parts.size());
+  return parts;
+}
+
+// Parts are usually extracted as Double_Point3, but any kernel's points can be
+// hulled. A token is checked before every part.
+template <typename Point = Double_Point3>
+std::vector<CGAL::Surface_mesh<Point>>
+hull_parts(const std::vector<std::vector<Point>> &parts,
+           const CancellationToken *token = nullptr) {
+  ScopedStage stage("hull", parts.size());
+  std::vector<CGAL::Surface_mesh<Point>> meshes;
+  for (const auto &part : parts) {
+    checkpoint(token, "hull", meshes.size(), parts.size());
     auto &mesh = meshes.emplace_back();
     CGAL::convex_hull_3(part.begin(), part.end(), mesh);
   }
+  checkpoint(token, "hull", parts.size(), parts.size());
+  stage.setOutputCount(meshes.size());
+  return meshes;
+}
+
+// Parallel variant of hull_parts(): Parts are hulled independently on the
+// pool. The meshes are returned in the same order as the input parts.
+template <typename Point = Double_Point3>
+std::vector<CGAL::Surface_mesh<Point>>
+hull_parts(const std::vector<std::vector<Point>> &parts, ThreadPool &pool,
+           const CancellationToken *token = nullptr) {
+  ScopedStage stage("hull", parts.size());
+  std::vector<CGAL::Surface_mesh<Point>> meshes(parts.size());
+  std::atomic<size_t> num_hulled{0};
+  pool.parallel_for(parts.size(), [&](size_t i) {
+    checkpoint(token, "hull", num_hulled++, parts.size());
+    CGAL::convex_hull_3(parts[i].begin(), parts[i].end(), meshes[i]);
+  });
+  checkpoint(token, "hull", parts.size(), parts.size());
+  stage.setOutputCount(meshes.size());
   return meshes;
 }
@@ -10,82 +10,92 @@
 
 #include "objects.h"
 
-CGAL_Nef_polyhedron3 convertUnionTwoNefCubes() {
+// The convert functions check a token between their steps and pass it on.
+// The direct Nef constructors and the union of the cube Nefs can't be
+// interrupted.
+CGAL_Nef_polyhedron3
+convertUnionTwoNefCubes(const CancellationToken *token = nullptr) {
   std::cout << "== Second attempt: Build Nef from two cubes == " << std::endl;
   SurfaceMesh first_cube_mesh = createSurfaceMesh(first_cube);
   SurfaceMesh second_cube_mesh = createSurfaceMesh(second_cube);
   writeMesh(first_cube_mesh, "first_cube1.off");
   writeMesh(second_cube_mesh, "first_cube2.off");
-  CGAL_Nef_polyhedron3 first_cube_nef(first_cube_mesh);
-  CGAL_Nef_polyhedron3 second_cube_nef(second_cube_mesh);
+  std::vector<CGAL_Nef_polyhedron3> cube_nefs;
+  throwIfCancelled(token);
+  cube_nefs.emplace_back(first_cube_mesh);
+  cube_nefs.emplace_back(second_cube_mesh);
 
-  CGAL_Nef_polyhedron3 sum_nef;
-  sum_nef += first_cube_nef;
-  sum_nef += second_cube_nef;
+  UnionStats union_stats;
+  throwIfCancelled(token);
+  CGAL_Nef_polyhedron3 sum_nef = unionNefs(std::move(cube_nefs), &union_stats);
+  std::cout << "Union: " << union_stats.overlays << " overlays, "
+            << union_stats.skipped_overlays << " skipped" << std::endl;
   writeNef(sum_nef, "second.nef3");
   printStats(sum_nef, "second");
   return sum_nef;
 }
 
-CGAL_Nef_polyhedron3 convertUnionAllFaces() {
+CGAL_Nef_polyhedron3
+convertUnionAllFaces(const CancellationToken *token = nullptr) {
   std::cout << "== First attempt: Build nef by unioning all faces == "
             << std::endl;
   SurfaceMesh touching_cubes_mesh = createSurfaceMesh(touching_cubes);
   writeMesh(touching_cubes_mesh, "first_touching_cubes.off");
-  const auto &mesh = touching_cubes_mesh;
-  CGAL::Nef_nary_union_3<CGAL_Nef_polyhedron3> nary_union;
-  int discarded_facets = 0;
-  for (const auto face : mesh.faces()) {
-    std::vector<CGAL::Point_3<CGAL_Kernel3>> vertices;
-    for (auto vd : CGAL::vertices_around_face(mesh.halfedge(face), mesh)) {
-      vertices.push_back(mesh.point(vd));
-    }
-
-    bool is_nef = false;
-    if (vertices.size() >= 1) {
-      CGAL_Nef_polyhedron3 nef(vertices.begin(), vertices.end());
-      if (!nef.is_empty()) {
-        nary_union.add_polyhedron(nef);
-        is_nef = true;
-      }
-    }
-    if (!is_nef) {
-      discarded_facets++;
-    }
-  }
-  if (discarded_facets > 0) {
-    std::cerr << "Discarded " << discarded_facets << " facets." << std::endl;
-  }
-  CGAL_Nef_polyhedron3 nef_union = nary_union.get_union();
-  CGAL::Mark_bounded_volumes<CGAL_Nef_polyhedron3> mbv(true);
-  nef_union.delegate(mbv);
+  CGAL_Nef_polyhedron3 nef_union =
+      unionMeshFacesToNef(touching_cubes_mesh, true, token);
   writeNef(nef_union, "first.nef3");
   printStats(nef_union, "first");
 
   return nef_union;
 }
 
-CGAL_Nef_polyhedron3 convertMeshWithTwoCubesDistinctVertices() {
+CGAL_Nef_polyhedron3
+convertMeshWithTwoCubesDistinctVertices(const CancellationToken *token = nullptr,
+                                        NefRaceReport *race_report = nullptr) {
   std::cout << "== Third attempt: Build Nef from a mesh with two cubes "
                "(distinct vertices) == "
             << std::endl;
   SurfaceMesh touching_cubes_mesh = createSurfaceMesh(touching_cubes);
   writeMesh(touching_cubes_mesh, "third_touching_cubes.off");
 
-  auto nef = convertSurfaceMeshToNef(touching_cubes_mesh);
+  auto nef = convertSurfaceMeshToNef(touching_cubes_mesh, nullptr, token,
+                                     race_report);
+  // Dumped here rather than in convertSurfaceMeshToNef(), so benchmarks
+  // calling that don't time the text serialization.
+  writeNef(nef, "third.nef3");
+  printStats(nef, "third");
   writeNef(nef, "fourth.nef3");
   printStats(nef, "fourth");
   return nef;
 }
 
-CGAL_Nef_polyhedron3 convertMeshWithTwoCubesMergedVertices() {
+CGAL_Nef_polyhedron3
+convertMeshWithTwoCubesMergedVertices(const CancellationToken *token = nullptr) {
   std::cout << "== Fourth attempt: Build Nef from a mesh with two cubes "
                "(merged vertices) == "
             << std::endl;
-  SurfaceMesh touching_cubes_mesh = createSurfaceMesh(touching_cubes_14);
+  // Welding the shared vertices of touching_cubes yields touching_cubes_14.
+  size_t num_merged = 0;
+  SurfaceMesh touching_cubes_mesh =
+      createSurfaceMesh(touching_cubes, 0.0, &num_merged);
+  std::cout << "Welding merged " << num_merged << " vertices" << std::endl;
   writeMesh(touching_cubes_mesh, "fourth_touching_cubes.off");
+  throwIfCancelled(token);
   CGAL_Nef_polyhedron3 touching_cubes_nef(touching_cubes_mesh);
   writeNef(touching_cubes_nef, "fourth.nef3");
   printStats(touching_cubes_nef, "fourth");
   return touching_cubes_nef;
 }
+
+CGAL_Nef_polyhedron3
+convertSoupWithTwoCubesMergedVertices(const CancellationToken *token = nullptr) {
+  std::cout << "== Sixth attempt: Build Nef from the triangle soup of two "
+               "cubes (merged vertices) == "
+            << std::endl;
+  // The shared edge is non-manifold, so the mesh of the fourth attempt lacks
+  // faces. Building from the soup splits the cubes apart first.
+  CGAL_Nef_polyhedron3 touching_cubes_nef = convertObjectToNef(touching_cubes_14, nullptr, token);
+  writeNef(touching_cubes_nef, "sixth.nef3");
+  printStats(touching_cubes_nef, "sixth");
+  return touching_cubes_nef;
+}
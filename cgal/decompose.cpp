@@ -14,6 +14,8 @@
 #undef NDEBUG
 #include <CGAL/IO/Nef_polyhedron_iostream_3.h>
 #pragma pop_macro("NDEBUG")
+#include "merge_parts.h"
+#include "nef_binary_io.h"
 
 using namespace CGALUtils;
 namespace fs = boost::filesystem;
@@ -237,14 +239,15 @@ public:
   void visit(CGAL_Nef_polyhedron3::SFace_const_handle ) {}
 };
 
+// Consumes nef: It is decomposed in place, so no copy of the SNC is made
+// unless another handle still shares it.
 template<class Output>
-void decompose(const CGAL_Nef_polyhedron3 *N, Output out_iter)
+void decompose(CGAL_Nef_polyhedron3 &&nef, Output out_iter)
 {
   int parts = 0;
-  assert(N);
   CGAL_Polyhedron poly;
-  if (N->is_simple()) {
-    N->convert_to_polyhedron(poly);
+  if (nef.is_simple()) {
+    nef.convert_to_polyhedron(poly);
   }
   if (is_weakly_convex(poly)) {
     PRINTD("Minkowski: Object is convex and Nef");
@@ -255,7 +258,7 @@ void decompose(const CGAL_Nef_polyhedron3 *N, Output out_iter)
   }
   else {
     PRINTD("Minkowski: Object is nonconvex Nef, decomposing...");
-    CGAL_Nef_polyhedron3 decomposed_nef = *N;
+    CGAL_Nef_polyhedron3 &decomposed_nef = nef;
     CGAL::convex_decomposition_3(decomposed_nef);
     
     // the first volume is the outer volume, which ignored in the decomposition
@@ -285,6 +288,37 @@ void decompose(const CGAL_Nef_polyhedron3 *N, Output out_iter)
   }
 }
 
+// Keeps *N: The decomposition works on a copy.
+template<class Output>
+void decompose(const CGAL_Nef_polyhedron3 *N, Output out_iter)
+{
+  assert(N);
+  decompose(CGAL_Nef_polyhedron3(*N), out_iter);
+}
+
+// Set by --merge-parts.
+bool merge_convex_parts = false;
+
+// Merges parts whose union is still convex, see mergeConvexParts(). The
+// Minkowski sum is quadratic in the number of parts.
+void mergeParts(std::vector<PolyhedronK> &parts)
+{
+  std::vector<std::vector<K::Point_3>> points;
+  for (const PolyhedronK &p : parts) {
+    points.emplace_back(p.points_begin(), p.points_end());
+  }
+  PartMergeStats stats;
+  auto merged = mergeConvexParts(std::move(points), &stats);
+  PRINTDB("Minkowski: merged %d convex parts into %d", stats.parts_before % stats.parts_after);
+  if (stats.parts_after == stats.parts_before) return;
+  parts.clear();
+  for (const auto &part : merged) {
+    PolyhedronK poly;
+    CGAL::convex_hull_3(part.begin(), part.end(), poly);
+    parts.push_back(poly);
+  }
+}
+
 Geometry const * minkowskitest(const Geometry::Geometries &children)
 {
   CGAL::Timer t,t_tot;
@@ -338,6 +372,7 @@ Geometry const * minkowskitest(const Geometry::Geometries &children)
         if (N && N->p3) {
           PRINTD("Decomposing...");
           decompose(N->p3.get(), std::back_inserter(convexP[i]));
+          if (merge_convex_parts) mergeParts(convexP[i]);
         }
 
         PRINTD("Hulling convex parts...");
@@ -642,6 +677,10 @@ int main(int argc, char *argv[])
 
   PolySet *ps = NULL;
   CGAL_Nef_polyhedron *N = NULL;
+  if (argc == 3 && std::string(argv[2]) == "--merge-parts") {
+    merge_convex_parts = true;
+    argc--;
+  }
   if (argc == 2) {
     std::string filename(argv[1]);
     std::string suffix = fs::path(filename).extension().generic_string();
@@ -658,18 +697,28 @@ int main(int argc, char *argv[])
       stream >> *N->p3;
       std::cerr << "Imported Nef polyhedron" << std::endl;
     }
+    else if (suffix == ".nef3b") {
+      N = new CGAL_Nef_polyhedron(new CGAL_Nef_polyhedron3);
+      if (!readNefBinary(filename, *N->p3)) exit(1);
+      std::cerr << "Imported Nef polyhedron" << std::endl;
+    }
   }
   else {
-    std::cerr << "Usage: " << argv[0] << " <file.stl> <file.stl>" << std::endl;
+    std::cerr << "Usage: " << argv[0] << " <file.stl> [--merge-parts]" << std::endl;
     exit(1);
   }
 
   if (ps && !N) N = createNefPolyhedronFromGeometry(*ps);
 
   std::vector<PolyhedronK> result;
-  decompose(N->p3.get(), std::back_inserter(result));
-
-  std::cerr << "Decomposed into " << result.size() << " convex parts" << std::endl;
+  // N isn't used afterwards, so it is decomposed in place.
+  decompose(std::move(*N->p3), std::back_inserter(result));
+  if (merge_convex_parts) {
+    const size_t num_decomposed = result.size();
+    mergeParts(result);
+    std::cerr << "Decomposed into " << num_decomposed << " convex parts, "
+              << result.size() << " after merging" << std::endl;
+  }
 
   int idx = 0;
   for(const PolyhedronK &P : result) {
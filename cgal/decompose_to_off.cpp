@@ -6,7 +6,12 @@ Try to convert to a Nef Polyhedron.
  */
 
 #include <array>
+#include <chrono>
+#include <csignal>
 #include <fstream>
+#include <mutex>
+#include <sstream>
+#include <thread>
 #include <vector>
 
 #include <CGAL/Exact_predicates_exact_constructions_kernel.h>
@@ -19,89 +24,268 @@ Try to convert to a Nef Polyhedron.
 
 #include "cgal_tools.h"
 #include "convert.h"
+#include "preview.h"
 #include <string>
 #include <CGAL/Polyhedron_3.h>
 
-void processUnionAllFaces() {
-  auto nef = convertUnionAllFaces();
+// Set by --merge-parts.
+bool merge_convex_parts = false;
 
-  if (!nef.is_valid()) {
-    std::cerr << "Nef is not valid!" << std::endl;
-    return;
+// Set by --slabs.
+size_t num_slabs = 1;
+
+// Set by --progress.
+bool show_progress = false;
+
+// Set by --preview.
+bool preview_first = false;
+
+// Token for building, decomposing and hulling the Nefs. Ctrl-C cancels it, so
+// the pipeline unwinds and the metrics are still written.
+CancellationToken pipeline_token([](const char *stage, size_t done,
+                                    size_t total) {
+  if (!show_progress) return;
+  static std::mutex mutex;
+  std::lock_guard<std::mutex> lock(mutex);
+  std::cerr << "\r" << stage << ": " << done << "/" << total << "   "
+            << (done == total ? "\n" : "") << std::flush;
+});
+
+// Cancellation waits for uninterruptible CGAL calls, so the handler is only
+// used once: A second Ctrl-C terminates the process.
+extern "C" void cancelPipeline(int) {
+  std::signal(SIGINT, SIG_DFL);
+  pipeline_token.cancel();
+}
+
+// Decomposes nef, with --slabs in slabs on the pool, see decomposeBySlabs().
+std::vector<std::vector<Double_Point3>> decomposeNef(CGAL_Nef_polyhedron3 &&nef,
+                                                     ThreadPool &pool) {
+  if (num_slabs > 1) {
+    return decomposeBySlabs(nef, num_slabs, pool, PartExtraction::Automatic,
+                            &pipeline_token);
   }
+  return decompose(std::move(nef), PartExtraction::Automatic, &pipeline_token);
+}
 
-  SurfaceMesh out_mesh;
-  convertNefToSurfaceMesh(nef, out_mesh);
-  writeMesh(out_mesh, "first.off");
+// Hulls the parts and writes one OFF file per part, both on the pool.
+// With --merge-parts, parts whose union is convex are merged first.
+void writeHulledParts(std::vector<std::vector<Double_Point3>> parts,
+                      const std::string &prefix, ThreadPool &pool) {
+  if (merge_convex_parts) {
+    PartMergeStats stats;
+    parts = mergeConvexParts(std::move(parts), &stats);
+    std::cout << "Merged parts: " << stats.parts_before << " -> "
+              << stats.parts_after << " (" << stats.hull_checks
+              << " hull checks)" << std::endl;
+  }
+  auto meshes = hull_parts(parts, pool, &pipeline_token);
+  pool.parallel_for(meshes.size(), [&](size_t i) {
+    writeMesh(meshes[i], prefix + "_part" + std::to_string(i) + ".off");
+  });
+}
 
-  auto parts = decompose(nef);
-  auto meshes = hull_parts(parts);
-  for (int i=0;i<meshes.size();i++) {
-    writeMesh(meshes[i], "first_part" + std::to_string(i) + ".off");
+// Writes the hulls of previewDecomposition() as <prefix>_preview_part<i>.off.
+// The report goes out in one piece, as the exact pipeline prints meanwhile.
+void writePreview(const Object &obj, const std::string &prefix) {
+  const Preview preview = previewDecomposition(obj);
+  for (size_t i = 0; i < preview.hulls.size(); ++i) {
+    writeMesh(preview.hulls[i],
+              prefix + "_preview_part" + std::to_string(i) + ".off");
   }
+  std::ostringstream report;
+  report << "Preview " << prefix << ":" << std::endl;
+  printPreview(preview, report);
+  std::cout << report.str() << std::flush;
 }
-void processUnionTwoNefCubes() {
-  auto nef = convertUnionTwoNefCubes();
 
-  if (!nef.is_valid()) {
+void processUnionAllFaces(ThreadPool &pool) {
+  auto nef = convertUnionAllFaces(&pipeline_token);
+
+  if (full_validity_checks && !nef.is_valid()) {
     std::cerr << "Nef is not valid!" << std::endl;
     return;
   }
 
-  SurfaceMesh out_mesh;
-  convertNefToSurfaceMesh(nef, out_mesh);
-  writeMesh(out_mesh, "second.off");
+  writeObject(convertNefToObject(nef), "first.off");
+
+  auto parts = decomposeNef(std::move(nef), pool);
+  writeHulledParts(std::move(parts), "first", pool);
+}
+void processUnionTwoNefCubes(ThreadPool &pool) {
+  auto nef = convertUnionTwoNefCubes(&pipeline_token);
 
-  auto parts = decompose(nef);
-  auto meshes = hull_parts(parts);
-  for (const auto& mesh : meshes) {
-    static int count = 0;
-    writeMesh(mesh, "second_part" + std::to_string(count++) + ".off");
+  if (full_validity_checks && !nef.is_valid()) {
+    std::cerr << "Nef is not valid!" << std::endl;
+    return;
   }
+
+  writeObject(convertNefToObject(nef), "second.off");
+
+  auto parts = decomposeNef(std::move(nef), pool);
+  writeHulledParts(std::move(parts), "second", pool);
 }
 
-void processMeshWithTwoCubesDistinctVertices() {
-  auto nef = convertMeshWithTwoCubesDistinctVertices();
+void processMeshWithTwoCubesDistinctVertices(ThreadPool &pool) {
+  NefRaceReport race;
+  auto nef = convertMeshWithTwoCubesDistinctVertices(&pipeline_token, &race);
+  if (nef_race_budget) {
+    std::cout << "Nef race: "
+              << (race.winner == NefStrategy::Direct ? "direct construction"
+                                                     : "face union")
+              << " won after " << race.wall_ms << " ms" << std::endl;
+  }
 
-  if (!nef.is_valid()) {
+  if (full_validity_checks && !nef.is_valid()) {
     std::cerr << "Nef is not valid!" << std::endl;
     return;
   }
 
-  SurfaceMesh out_mesh;
-  convertNefToSurfaceMesh(nef, out_mesh);
-  writeMesh(out_mesh, "third.off");
+  writeObject(convertNefToObject(nef), "third.off");
+
+  auto parts = decomposeNef(std::move(nef), pool);
+  writeHulledParts(std::move(parts), "third", pool);
+}
 
-  auto parts = decompose(nef);
-  auto meshes = hull_parts(parts);
-  for (int i=0;i<meshes.size();i++) {
-    writeMesh(meshes[i], "third_part" + std::to_string(i) + ".off");
+void processMeshWithTwoCubesMergedVertices(ThreadPool &pool) {
+  auto nef = convertMeshWithTwoCubesMergedVertices(&pipeline_token);
+
+  if (full_validity_checks && !nef.is_valid()) {
+    std::cerr << "Nef is not valid!" << std::endl;
+    return;
   }
+
+  writeObject(convertNefToObject(nef), "fourth.off");
+
+  auto parts = decomposeNef(std::move(nef), pool);
+  writeHulledParts(std::move(parts), "fourth", pool);
 }
 
-void processMeshWithTwoCubesMergedVertices() {
-  auto nef = convertMeshWithTwoCubesMergedVertices();
+void processSoupWithTwoCubesMergedVertices(ThreadPool &pool) {
+  auto nef = convertSoupWithTwoCubesMergedVertices(&pipeline_token);
 
-  if (!nef.is_valid()) {
+  if (full_validity_checks && !nef.is_valid()) {
     std::cerr << "Nef is not valid!" << std::endl;
     return;
   }
 
-  SurfaceMesh out_mesh;
-  convertNefToSurfaceMesh(nef, out_mesh);
-  writeMesh(out_mesh, "fourth.off");
+  writeObject(convertNefToObject(nef), "sixth.off");
 
-  auto parts = decompose(nef);
-  auto meshes = hull_parts(parts);
-  for (int i=0;i<meshes.size();i++) {
-    writeMesh(meshes[i], "fourth_part" + std::to_string(i) + ".off");
+  auto parts = decomposeNef(std::move(nef), pool);
+  writeHulledParts(std::move(parts), "sixth", pool);
+}
+
+void processSeparateCubesByComponent(ThreadPool &pool) {
+  std::cout << "== Fifth attempt: Build Nef per connected component == "
+            << std::endl;
+  SurfaceMesh separate_cubes_mesh = createSurfaceMesh(separate_cubes);
+  auto nef = convertSurfaceMeshToNefByComponent(separate_cubes_mesh, pool,
+                                                &pipeline_token);
+  printStats(nef, "fifth");
+
+  if (full_validity_checks && !nef.is_valid()) {
+    std::cerr << "Nef is not valid!" << std::endl;
+    return;
   }
+
+  writeObject(convertNefToObject(nef), "fifth.off");
+
+  auto parts = decomposeNef(std::move(nef), pool);
+  writeHulledParts(std::move(parts), "fifth", pool);
 }
 
 int main(int argc, char *argv[]) {
-  processUnionAllFaces();
-  processUnionTwoNefCubes();
-  processMeshWithTwoCubesDistinctVertices();
-  processMeshWithTwoCubesMergedVertices();
-  return 0;
+  std::string metrics_file;
+  bool gmp_stats = false;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--check") {
+      full_validity_checks = true;
+    } else if (arg == "--metrics" && i + 1 < argc) {
+      metrics_file = argv[++i];
+    } else if (arg == "--gmp-stats") {
+      gmp_stats = true;
+    } else if (arg == "--slabs" && i + 1 < argc) {
+      num_slabs = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--merge-parts") {
+      merge_convex_parts = true;
+    } else if (arg == "--race" && i + 1 < argc) {
+      nef_race_budget = std::chrono::milliseconds(std::stoi(argv[++i]));
+    } else if (arg == "--progress") {
+      show_progress = true;
+    } else if (arg == "--preview") {
+      preview_first = true;
+    } else {
+      std::cerr << "Usage: " << argv[0]
+                << " [--check] [--metrics <file.jsonl>] [--gmp-stats]"
+                   " [--race <ms>] [--merge-parts] [--slabs <n>] [--progress]"
+                   " [--preview]"
+                << std::endl;
+      return 1;
+    }
+  }
+  if (gmp_stats) gmp_allocator::install();
+
+  PipelineMetrics metrics;
+  if (!metrics_file.empty() || gmp_stats) {
+    metrics.setLabel("tool", "decompose_to_off");
+    metrics.setLabel("kernel", CGAL_Kernel3_name);
+    current_metrics = &metrics;
+  }
+
+  std::signal(SIGINT, cancelPipeline);
+  int status = 0;
+  ThreadPool pool;
+  auto runExact = [&]() {
+    try {
+      processUnionAllFaces(pool);
+      processUnionTwoNefCubes(pool);
+      processMeshWithTwoCubesDistinctVertices(pool);
+      processMeshWithTwoCubesMergedVertices(pool);
+      processSeparateCubesByComponent(pool);
+      processSoupWithTwoCubesMergedVertices(pool);
+    } catch (const Cancelled &) {
+      std::cerr << "Cancelled" << std::endl;
+      status = 130;
+    } catch (const NefBudgetExceeded &e) {
+      std::cerr << "Error: " << e.what() << std::endl;
+      status = 1;
+    }
+  };
+  if (preview_first) {
+    // The previews don't use the pool, so the exact pipeline keeps it.
+    std::thread exact(runExact);
+    const auto start = std::chrono::steady_clock::now();
+    writePreview(touching_cubes, "first");
+    writePreview(touching_cubes, "second");
+    writePreview(touching_cubes, "third");
+    writePreview(touching_cubes_14, "fourth");
+    writePreview(separate_cubes, "fifth");
+    writePreview(touching_cubes_14, "sixth");
+    std::cout << "Previews done in "
+              << std::chrono::duration<double, std::milli>(
+                     std::chrono::steady_clock::now() - start)
+                     .count()
+              << " ms" << std::endl;
+    exact.join();
+  } else {
+    runExact();
+  }
+  joinAbandonedWorkers();
+
+  if (!metrics_file.empty()) {
+    std::ofstream out(metrics_file, std::ios::app);
+    metrics.writeJson(out);
+  }
+  if (gmp_stats) {
+    for (const auto &stage : metrics.stages()) {
+      std::cerr << "  " << stage.name
+                << (stage.parent.empty() ? "" : " (in " + stage.parent + ")")
+                << ": " << stage.gmp_allocations
+                << " GMP allocations, " << stage.gmp_bytes / 1024.0 << " KiB"
+                << std::endl;
+    }
+    gmp_allocator::printStats(std::cerr);
+  }
+  return status;
 }
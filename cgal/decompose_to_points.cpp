@@ -32,7 +32,10 @@ void processUnionAllFaces() {
   convertNefToSurfaceMesh(nef, out_mesh);
   writeMesh(out_mesh, "first.off");
 
-  auto parts = decompose(nef);
+  // Only the per-part log is of interest, so parts are dropped as they come.
+  decompose_to_sink(
+      std::move(nef), [](std::vector<Double_Point3> &&) {},
+      PartExtraction::Polyhedron, /*verbose=*/true);
 }
 void processUnionTwoNefCubes() {
   auto nef = convertUnionTwoNefCubes();
@@ -46,7 +49,10 @@ void processUnionTwoNefCubes() {
   convertNefToSurfaceMesh(nef, out_mesh);
   writeMesh(out_mesh, "second.off");
 
-  auto parts = decompose(nef);
+  // Only the per-part log is of interest, so parts are dropped as they come.
+  decompose_to_sink(
+      std::move(nef), [](std::vector<Double_Point3> &&) {},
+      PartExtraction::Polyhedron, /*verbose=*/true);
 }
 
 void processMeshWithTwoCubesDistinctVertices() {
@@ -61,7 +67,10 @@ void processMeshWithTwoCubesDistinctVertices() {
   convertNefToSurfaceMesh(nef, out_mesh);
   writeMesh(out_mesh, "third.off");
 
-  auto parts = decompose(nef);
+  // Only the per-part log is of interest, so parts are dropped as they come.
+  decompose_to_sink(
+      std::move(nef), [](std::vector<Double_Point3> &&) {},
+      PartExtraction::Polyhedron, /*verbose=*/true);
 }
 
 void processMeshWithTwoCubesMergedVertices() {
@@ -76,7 +85,10 @@ void processMeshWithTwoCubesMergedVertices() {
   convertNefToSurfaceMesh(nef, out_mesh);
   writeMesh(out_mesh, "fourth.off");
 
-  auto parts = decompose(nef);
+  // Only the per-part log is of interest, so parts are dropped as they come.
+  decompose_to_sink(
+      std::move(nef), [](std::vector<Double_Point3> &&) {},
+      PartExtraction::Polyhedron, /*verbose=*/true);
 }
 
 int main(int argc, char *argv[]) {
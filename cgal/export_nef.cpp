@@ -15,6 +15,7 @@
 #undef NDEBUG
 #include <CGAL/IO/Nef_polyhedron_iostream_3.h>
 #pragma pop_macro("NDEBUG")
+#include "nef_binary_io.h"
 
 using namespace CGALUtils;
 namespace fs=boost::filesystem;
@@ -171,6 +172,11 @@ int main(int argc, char *argv[])
       stream >> *N->p3;
       std::cerr << "Imported Nef polyhedron" << std::endl;
     }
+    else if (suffix == ".nef3b") {
+      N = new CGAL_Nef_polyhedron(new CGAL_Nef_polyhedron3);
+      if (!readNefBinary(filename, *N->p3)) exit(1);
+      std::cerr << "Imported Nef polyhedron" << std::endl;
+    }
   }
   else {
     std::cerr << "Usage: " << argv[0] << " <file.stl>" << std::endl;
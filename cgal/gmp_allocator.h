@@ -0,0 +1,238 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+#include <gmp.h>
+
+// Opt-in GMP allocator for the exact arithmetic in the Nef pipeline: Limb
+// allocations of up to max_pooled bytes are served from thread-local free
+// lists, one per size, which are refilled from large arena chunks. Larger
+// blocks go to malloc. Every allocation is counted, so ScopedStage can report
+// allocations per pipeline stage.
+//
+// Size classes are exact multiples of 8 bytes, and GMP passes the block size
+// to free and realloc, so blocks that were malloc'ed before install() can be
+// recycled safely. The opposite is not true: Once installed, the allocator
+// must stay installed, and pooled memory is never returned to the system.
+// Counters follow their cache, so per-thread numbers are not meaningful, only
+// the totals from stats().
+namespace gmp_allocator {
+
+constexpr size_t granularity = 8;
+constexpr size_t max_pooled = 512;
+constexpr size_t num_classes = max_pooled / granularity;
+constexpr size_t chunk_size = size_t(1) << 20;
+
+struct Stats {
+  uint64_t allocations = 0;
+  uint64_t reallocations = 0;
+  uint64_t frees = 0;
+  uint64_t bytes = 0;  // requested by allocations and reallocations
+  uint64_t pooled = 0; // allocations served from the free lists or arenas
+  uint64_t arena_bytes = 0;
+};
+
+// Counters of one thread. Only the owning thread writes them, so relaxed
+// load/store pairs are enough and there is no contention between threads.
+struct Counters {
+  std::atomic<uint64_t> allocations{0};
+  std::atomic<uint64_t> reallocations{0};
+  std::atomic<uint64_t> frees{0};
+  std::atomic<uint64_t> bytes{0};
+  std::atomic<uint64_t> pooled{0};
+  std::atomic<uint64_t> arena_bytes{0};
+
+  static void add(std::atomic<uint64_t> &counter, uint64_t n) {
+    counter.store(counter.load(std::memory_order_relaxed) + n,
+                  std::memory_order_relaxed);
+  }
+};
+
+class ThreadCache;
+
+struct Registry {
+  std::mutex mutex;
+  std::deque<Counters> counters; // stable addresses, outlive their threads
+  std::vector<ThreadCache *> orphans; // caches of exited threads
+  bool installed = false;
+};
+
+inline Registry &registry() {
+  static Registry *r = new Registry; // never destroyed: used until exit
+  return *r;
+}
+
+struct FreeBlock {
+  FreeBlock *next;
+};
+
+class ThreadCache {
+public:
+  ThreadCache() {
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    counters_ = &r.counters.emplace_back();
+  }
+
+  static bool poolable(size_t size) {
+    return size > 0 && size <= max_pooled && size % granularity == 0;
+  }
+
+  void *allocate(size_t size) {
+    Counters::add(counters_->allocations, 1);
+    Counters::add(counters_->bytes, size);
+    if (poolable(size)) Counters::add(counters_->pooled, 1);
+    return take(size);
+  }
+
+  void *reallocate(void *p, size_t old_size, size_t new_size) {
+    Counters::add(counters_->reallocations, 1);
+    Counters::add(counters_->bytes, new_size);
+    if (!poolable(old_size) && !poolable(new_size)) {
+      return checked(std::realloc(p, new_size));
+    }
+    void *q = take(new_size);
+    std::memcpy(q, p, std::min(old_size, new_size));
+    release(p, old_size);
+    return q;
+  }
+
+  void deallocate(void *p, size_t size) {
+    Counters::add(counters_->frees, 1);
+    release(p, size);
+  }
+
+private:
+  void *take(size_t size) {
+    if (!poolable(size)) return checked(std::malloc(size));
+    FreeBlock *&list = free_lists_[size / granularity - 1];
+    if (list) {
+      FreeBlock *block = list;
+      list = block->next;
+      return block;
+    }
+    if (size_t(chunk_end_ - chunk_pos_) < size) {
+      chunk_pos_ = static_cast<char *>(checked(std::malloc(chunk_size)));
+      chunk_end_ = chunk_pos_ + chunk_size;
+      Counters::add(counters_->arena_bytes, chunk_size);
+    }
+    void *p = chunk_pos_;
+    chunk_pos_ += size;
+    return p;
+  }
+
+  void release(void *p, size_t size) {
+    if (!poolable(size)) {
+      std::free(p);
+      return;
+    }
+    auto *block = static_cast<FreeBlock *>(p);
+    FreeBlock *&list = free_lists_[size / granularity - 1];
+    block->next = list;
+    list = block;
+  }
+
+  static void *checked(void *p) {
+    if (!p) {
+      std::cerr << "GMP allocator: out of memory" << std::endl;
+      std::abort();
+    }
+    return p;
+  }
+
+  FreeBlock *free_lists_[num_classes] = {};
+  char *chunk_pos_ = nullptr;
+  char *chunk_end_ = nullptr;
+  Counters *counters_;
+};
+
+// The cache pointer is trivially destructible, so GMP calls during thread or
+// static destruction still find a cache. When a thread exits, its cache, free
+// lists and arena included, is handed over to the next new thread.
+inline thread_local ThreadCache *current_cache = nullptr;
+
+struct CacheReleaser {
+  ~CacheReleaser() {
+    if (!current_cache) return;
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.orphans.push_back(current_cache);
+    current_cache = nullptr;
+  }
+};
+
+inline ThreadCache &cache() {
+  if (!current_cache) {
+    thread_local CacheReleaser releaser;
+    {
+      Registry &r = registry();
+      std::lock_guard<std::mutex> lock(r.mutex);
+      if (!r.orphans.empty()) {
+        current_cache = r.orphans.back();
+        r.orphans.pop_back();
+      }
+    }
+    if (!current_cache) current_cache = new ThreadCache;
+  }
+  return *current_cache;
+}
+
+inline void *gmpAllocate(size_t size) { return cache().allocate(size); }
+inline void *gmpReallocate(void *p, size_t old_size, size_t new_size) {
+  return cache().reallocate(p, old_size, new_size);
+}
+inline void gmpFree(void *p, size_t size) { cache().deallocate(p, size); }
+
+// Installs the allocator for all GMP (and thus Gmpq/Gmpz) allocations.
+// Call early in main(), before any threads use GMP.
+inline void install() {
+  Registry &r = registry();
+  {
+    std::lock_guard<std::mutex> lock(r.mutex);
+    if (r.installed) return;
+    r.installed = true;
+  }
+  mp_set_memory_functions(gmpAllocate, gmpReallocate, gmpFree);
+}
+
+inline bool installed() {
+  Registry &r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  return r.installed;
+}
+
+// Totals over all threads so far. Per-stage numbers are differences of these.
+inline Stats stats() {
+  Registry &r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  Stats s;
+  for (const Counters &c : r.counters) {
+    s.allocations += c.allocations.load(std::memory_order_relaxed);
+    s.reallocations += c.reallocations.load(std::memory_order_relaxed);
+    s.frees += c.frees.load(std::memory_order_relaxed);
+    s.bytes += c.bytes.load(std::memory_order_relaxed);
+    s.pooled += c.pooled.load(std::memory_order_relaxed);
+    s.arena_bytes += c.arena_bytes.load(std::memory_order_relaxed);
+  }
+  return s;
+}
+
+inline void printStats(std::ostream &out) {
+  const Stats s = stats();
+  out << "GMP allocator: " << s.allocations << " allocations ("
+      << (s.allocations ? 100.0 * s.pooled / s.allocations : 0.0)
+      << "% pooled), " << s.reallocations << " reallocations, " << s.frees
+      << " frees, " << s.bytes / (1024.0 * 1024.0) << " MiB requested, "
+      << s.arena_bytes / (1024.0 * 1024.0) << " MiB arenas" << std::endl;
+}
+
+} // namespace gmp_allocator
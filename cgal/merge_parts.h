@@ -0,0 +1,132 @@
+#pragma once
+
+#include <deque>
+#include <iostream>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <CGAL/Bbox_3.h>
+#include <CGAL/Exact_predicates_exact_constructions_kernel.h>
+#include <CGAL/Polygon_mesh_processing/measure.h>
+#include <CGAL/Surface_mesh.h>
+#include <CGAL/boost/graph/helpers.h>
+#include <CGAL/convex_hull_3.h>
+
+#include "metrics.h"
+
+// Statistics of a mergeConvexParts() call.
+struct PartMergeStats {
+  size_t parts_before = 0;
+  size_t parts_after = 0;
+  size_t hull_checks = 0; // hulls of candidate pairs computed
+};
+
+namespace merge_parts {
+
+using Point = CGAL::Epeck::Point_3;
+
+struct Hull {
+  std::vector<Point> points; // vertices of the hull
+  CGAL::Epeck::FT volume = 0;
+  CGAL::Bbox_3 bbox;
+};
+
+inline Hull hullOf(const std::vector<Point> &points) {
+  Hull hull;
+  for (const auto &p : points) hull.bbox += p.bbox();
+  if (points.size() < 4) {
+    hull.points = points;
+    return hull;
+  }
+  CGAL::Surface_mesh<Point> mesh;
+  CGAL::convex_hull_3(points.begin(), points.end(), mesh);
+  for (const auto v : mesh.vertices()) hull.points.push_back(mesh.point(v));
+  if (!mesh.is_empty() && CGAL::is_closed(mesh)) {
+    hull.volume = CGAL::Polygon_mesh_processing::volume(mesh);
+  }
+  return hull;
+}
+
+} // namespace merge_parts
+
+// Greedily merges convex parts (e.g. from decompose()) whose union is still
+// convex. Parts of a decomposition have disjoint interiors, so the union of
+// two parts is convex exactly if the volume of their common hull equals the
+// sum of their volumes. Hulls and volumes use Epeck, so that comparison is
+// exact. Flat parts are only merged into parts with volume.
+// Only parts with touching bounding boxes are tested. A merged part is
+// represented by its hull vertices. Parts wait in a worklist; a part that
+// grew goes back to the end of it, and only its pairs are tested again.
+// Point must provide x(), y(), z() and a constructor from three doubles.
+template <typename Point>
+std::vector<std::vector<Point>>
+mergeConvexParts(std::vector<std::vector<Point>> &&parts,
+                 PartMergeStats *stats = nullptr) {
+  using merge_parts::Hull;
+  ScopedStage stage("part_merging", parts.size());
+  PartMergeStats local_stats;
+  PartMergeStats &s = stats ? *stats : local_stats;
+  s = PartMergeStats{parts.size()};
+
+  std::vector<Hull> hulls;
+  hulls.reserve(parts.size());
+  for (auto &part : parts) {
+    std::vector<merge_parts::Point> points;
+    points.reserve(part.size());
+    for (const auto &p : part) points.emplace_back(p.x(), p.y(), p.z());
+    std::vector<Point>().swap(part);
+    hulls.push_back(merge_parts::hullOf(points));
+  }
+
+  const size_t n = hulls.size();
+  std::vector<char> alive(n, true);
+  std::deque<size_t> worklist;
+  for (size_t i = 0; i < n; ++i) worklist.push_back(i);
+  // rejected[i]: parts that don't merge with part i in its current shape.
+  std::vector<std::unordered_set<size_t>> rejected(n);
+  while (!worklist.empty()) {
+    const size_t i = worklist.front();
+    worklist.pop_front();
+    if (!alive[i]) continue;
+    bool grown = false;
+    for (size_t j = 0; j < n; ++j) {
+      if (j == i || !alive[j] || rejected[i].count(j) ||
+          !CGAL::do_overlap(hulls[i].bbox, hulls[j].bbox)) {
+        continue;
+      }
+      std::vector<merge_parts::Point> points = hulls[i].points;
+      points.insert(points.end(), hulls[j].points.begin(),
+                    hulls[j].points.end());
+      Hull combined = merge_parts::hullOf(points);
+      s.hull_checks++;
+      if (combined.volume > 0 &&
+          combined.volume == hulls[i].volume + hulls[j].volume) {
+        hulls[i] = std::move(combined);
+        alive[j] = false;
+        grown = true;
+        for (const size_t k : rejected[i]) rejected[k].erase(i);
+        rejected[i].clear();
+      } else {
+        rejected[i].insert(j);
+        rejected[j].insert(i);
+      }
+    }
+    // Parts rejected before the last merge get another chance.
+    if (grown) worklist.push_back(i);
+  }
+
+  std::vector<std::vector<Point>> result;
+  for (size_t i = 0; i < hulls.size(); ++i) {
+    if (!alive[i]) continue;
+    auto &part = result.emplace_back();
+    part.reserve(hulls[i].points.size());
+    for (const auto &p : hulls[i].points) {
+      part.emplace_back(CGAL::to_double(p.x()), CGAL::to_double(p.y()),
+                        CGAL::to_double(p.z()));
+    }
+  }
+  s.parts_after = result.size();
+  stage.setOutputCount(result.size());
+  return result;
+}
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <time.h>
+#endif
+
+#include <CGAL/Real_timer.h>
+#include <CGAL/Timer.h>
+
+#include "gmp_allocator.h"
+
+// Innermost stage open on this thread, see ScopedStage and StageParent.
+inline thread_local const char *current_stage = nullptr;
+
+// Per-stage wall time, CPU time and element counts for the conversion
+// pipeline. Repeated invocations of a stage (e.g. one hull per part) are
+// summed into one entry. CPU time is process time, so it includes all
+// threads working while the stage ran. The same holds for the GMP allocation
+// counts, which are only collected while gmp_allocator is installed.
+//
+// A stage that runs within another one (e.g. mesh_build and
+// convex_decomposition within slab_decomposition, or manifold_split within
+// soup_build) is recorded with that one as its parent, in an entry of its
+// own. Its time is included in the parent's, so only the stages without a
+// parent are exclusive of each other and can be summed.
+class PipelineMetrics {
+public:
+  struct Stage {
+    std::string name;
+    std::string parent; // empty at the top level
+    size_t calls = 0;
+    double wall_ms = 0;
+    double cpu_ms = 0;
+    size_t input_count = 0;
+    size_t output_count = 0;
+    uint64_t gmp_allocations = 0;
+    uint64_t gmp_bytes = 0;
+  };
+
+  void setLabel(const std::string &key, const std::string &value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    labels_.emplace_back(key, value);
+  }
+
+  // Records an invocation of the named stage within the stage open on the
+  // calling thread, if any.
+  void record(const std::string &name, double wall_ms, double cpu_ms,
+              size_t input_count, size_t output_count,
+              uint64_t gmp_allocations = 0, uint64_t gmp_bytes = 0) {
+    const std::string parent = current_stage ? current_stage : "";
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::find_if(stages_.begin(), stages_.end(), [&](const Stage &s) {
+      return s.name == name && s.parent == parent;
+    });
+    if (it == stages_.end()) {
+      it = stages_.insert(stages_.end(), Stage{name, parent});
+    }
+    it->calls++;
+    it->wall_ms += wall_ms;
+    it->cpu_ms += cpu_ms;
+    it->input_count += input_count;
+    it->output_count += output_count;
+    it->gmp_allocations += gmp_allocations;
+    it->gmp_bytes += gmp_bytes;
+  }
+
+  std::vector<Stage> stages() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stages_;
+  }
+
+  // Writes the whole run as a single line of JSON.
+  void writeJson(std::ostream &out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    out << "{";
+    for (const auto &[key, value] : labels_) {
+      out << quoted(key) << ":" << quoted(value) << ",";
+    }
+    out << "\"stages\":[";
+    for (size_t i = 0; i < stages_.size(); ++i) {
+      const Stage &s = stages_[i];
+      out << (i > 0 ? "," : "") << "{\"name\":" << quoted(s.name);
+      if (!s.parent.empty()) out << ",\"parent\":" << quoted(s.parent);
+      out << ",\"calls\":" << s.calls << ",\"wall_ms\":" << s.wall_ms
+          << ",\"cpu_ms\":" << s.cpu_ms << ",\"input\":" << s.input_count
+          << ",\"output\":" << s.output_count;
+      if (gmp_allocator::installed()) {
+        out << ",\"gmp_allocations\":" << s.gmp_allocations
+            << ",\"gmp_bytes\":" << s.gmp_bytes;
+      }
+      out << "}";
+    }
+    out << "]}" << std::endl;
+  }
+
+private:
+  static std::string quoted(const std::string &str) {
+    std::string result = "\"";
+    for (char c : str) {
+      if (c == '"' || c == '\\') result += '\\';
+      result += c;
+    }
+    return result + "\"";
+  }
+
+  mutable std::mutex mutex_;
+  std::vector<std::pair<std::string, std::string>> labels_;
+  std::vector<Stage> stages_;
+};
+
+// Peak resident set size of this process in MiB, or 0 where unsupported.
+inline double peakRSS() {
+#ifdef _WIN32
+  return 0;
+#else
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss / (1024.0 * 1024.0); // bytes
+#else
+  return usage.ru_maxrss / 1024.0; // KiB
+#endif
+#endif
+}
+
+// CPU time of the calling thread in ms, or 0 where unsupported. For work on
+// a thread of its own, where the process time would include all others.
+inline double threadCpuMs() {
+#ifdef _WIN32
+  return 0;
+#else
+  struct timespec ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) return 0;
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+#endif
+}
+
+// Metrics of the current run. Stages are only timed while this is set.
+inline PipelineMetrics *current_metrics = nullptr;
+
+// Times the enclosing scope as one invocation of the named stage, nested in
+// the stage open on this thread when it starts.
+class ScopedStage {
+public:
+  explicit ScopedStage(const char *name, size_t input_count = 0)
+      : metrics_(current_metrics), name_(name), input_count_(input_count),
+        parent_(current_stage) {
+    current_stage = name;
+    if (metrics_) {
+      if (gmp_allocator::installed()) gmp_start_ = gmp_allocator::stats();
+      wall_.start();
+      cpu_.start();
+    }
+  }
+
+  ~ScopedStage() {
+    current_stage = parent_;
+    if (metrics_) {
+      wall_.stop();
+      cpu_.stop();
+      gmp_allocator::Stats gmp_end = gmp_start_;
+      if (gmp_allocator::installed()) gmp_end = gmp_allocator::stats();
+      metrics_->record(name_, wall_.time() * 1000, cpu_.time() * 1000,
+                       input_count_, output_count_,
+                       gmp_end.allocations - gmp_start_.allocations,
+                       gmp_end.bytes - gmp_start_.bytes);
+    }
+  }
+
+  ScopedStage(const ScopedStage &) = delete;
+  ScopedStage &operator=(const ScopedStage &) = delete;
+
+  void setInputCount(size_t count) { input_count_ = count; }
+  void setOutputCount(size_t count) { output_count_ = count; }
+
+private:
+  PipelineMetrics *metrics_;
+  const char *name_;
+  size_t input_count_;
+  size_t output_count_ = 0;
+  const char *parent_;
+  CGAL::Real_timer wall_;
+  CGAL::Timer cpu_;
+  gmp_allocator::Stats gmp_start_;
+};
+
+// Nests the stages of work handed to another thread (pool tasks, race
+// threads) in the stage that handed it over: Take current_stage on the
+// handing thread and open a StageParent with it in the task.
+class StageParent {
+public:
+  explicit StageParent(const char *parent) : saved_(current_stage) {
+    current_stage = parent;
+  }
+  ~StageParent() { current_stage = saved_; }
+
+  StageParent(const StageParent &) = delete;
+  StageParent &operator=(const StageParent &) = delete;
+
+private:
+  const char *saved_;
+};
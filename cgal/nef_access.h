@@ -0,0 +1,38 @@
+#pragma once
+
+#include <CGAL/Nef_polyhedron_3.h>
+
+// Exposes the protected SNC structure and point locator of a Nef polyhedron,
+// for code that builds or copies the SNC directly, like the iostream
+// operators do as friends.
+template <typename Nef> struct NefAccess : Nef {
+  using SNC_structure = typename Nef::SNC_structure;
+  using SNC_point_locator = typename Nef::SNC_point_locator;
+
+  static SNC_structure &structure(Nef &nef) {
+    SNC_structure &(Nef::*fn)() = &NefAccess::snc;
+    return (nef.*fn)();
+  }
+  static const SNC_structure &structure(const Nef &nef) {
+    const SNC_structure &(Nef::*fn)() const = &NefAccess::snc;
+    return (nef.*fn)();
+  }
+  static SNC_point_locator *&locator(Nef &nef) {
+    SNC_point_locator *&(Nef::*fn)() = &NefAccess::pl;
+    return (nef.*fn)();
+  }
+};
+
+// Copies the edge/loop indices of SNC_indexed_items; no-op for plain items.
+template <typename Item>
+auto copyItemIndex(Item &dst, const Item &src, int)
+    -> decltype(dst.set_forward_index(src.get_forward_index()), void()) {
+  dst.set_forward_index(src.get_forward_index());
+  dst.set_backward_index(src.get_backward_index());
+}
+template <typename Item>
+auto copyItemIndex(Item &dst, const Item &src, long)
+    -> decltype(dst.set_index(src.get_index()), void()) {
+  dst.set_index(src.get_index());
+}
+template <typename Item> void copyItemIndex(Item &, const Item &, ...) {}
@@ -0,0 +1,239 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <gmp.h>
+
+#include "nef_records.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+  Binary Selective Nef Complex format (.nef3b)
+
+  Stores the SNC as the flat arrays of nef_records.h: the records of the
+  text format written by operator<< (vertices, halfedges, facets, volumes,
+  shalfedges, shalfloops, sfaces, cross-referenced by index), their boundary
+  entries, and every distinct exact number once as raw GMP limbs instead of
+  decimal text. Reading maps the file into memory and thaws the records in
+  place; the limbs are copied straight into the Gmpq coordinates.
+
+  Layout, in host byte order:
+    char[8]    magic "NEF3BIN\0"
+    uint32     version
+    uint32     byte order mark 0x01020304
+    uint32     sizeof(mp_limb_t)
+    uint32     reserved
+    uint64[11] lengths of the arrays, in the order of
+               nef_records::forEachArray()
+  followed by the arrays, each 8 byte aligned.
+
+  Only kernels with Gmpq coordinates (e.g. Cartesian<Gmpq>) are supported.
+*/
+namespace nef_binary {
+
+constexpr char magic[8] = {'N', 'E', 'F', '3', 'B', 'I', 'N', '\0'};
+constexpr uint32_t version = 2;
+constexpr uint32_t byte_order_mark = 0x01020304;
+
+class Writer {
+public:
+  explicit Writer(std::ostream &out) : out_(out) {}
+
+  void bytes(const void *data, size_t n) {
+    out_.write(static_cast<const char *>(data), n);
+    offset_ += n;
+  }
+  template <typename T> void value(const T &v) { bytes(&v, sizeof(v)); }
+  void align() {
+    static const char zeros[8] = {};
+    if (offset_ % 8 != 0) bytes(zeros, 8 - offset_ % 8);
+  }
+
+private:
+  std::ostream &out_;
+  size_t offset_ = 0;
+};
+
+class Reader {
+public:
+  Reader(const char *data, size_t size) : data_(data), size_(size) {}
+
+  const void *bytes(size_t n) {
+    if (size_ - offset_ < n) throw std::runtime_error("Truncated file");
+    const char *p = data_ + offset_;
+    offset_ += n;
+    return p;
+  }
+  template <typename T> T value() {
+    T v;
+    std::memcpy(&v, bytes(sizeof(T)), sizeof(T));
+    return v;
+  }
+  void align() {
+    const size_t padding = (8 - offset_ % 8) % 8;
+    bytes(padding);
+  }
+  // n records of type T, used in place. The data is 8 byte aligned, see
+  // MappedFile, so aligned offsets are aligned addresses.
+  template <typename T> const T *array(uint64_t n) {
+    align();
+    if (n > (size_ - offset_) / sizeof(T)) {
+      throw std::runtime_error("Truncated file");
+    }
+    return static_cast<const T *>(bytes(n * sizeof(T)));
+  }
+
+private:
+  const char *data_;
+  size_t size_;
+  size_t offset_ = 0;
+};
+
+// Maps a whole file into memory, or reads it into a buffer where mmap is not
+// available.
+class MappedFile {
+public:
+  explicit MappedFile(const std::string &filename) {
+#ifndef _WIN32
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+      void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p != MAP_FAILED) {
+        data_ = static_cast<const char *>(p);
+        size_ = st.st_size;
+      }
+    }
+    close(fd);
+#else
+    std::ifstream in(filename, std::ios::binary | std::ios::ate);
+    if (!in) return;
+    size_ = in.tellg();
+    buffer_.resize((size_ + 7) / 8); // uint64_t keeps the limbs aligned
+    in.seekg(0);
+    in.read(reinterpret_cast<char *>(buffer_.data()), size_);
+    data_ = reinterpret_cast<const char *>(buffer_.data());
+#endif
+  }
+  ~MappedFile() {
+#ifndef _WIN32
+    if (data_) munmap(const_cast<char *>(data_), size_);
+#endif
+  }
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  const char *data() const { return data_; }
+  size_t size() const { return size_; }
+
+private:
+  const char *data_ = nullptr;
+  size_t size_ = 0;
+#ifdef _WIN32
+  std::vector<uint64_t> buffer_;
+#endif
+};
+
+template <typename Nef> void write(const Nef &nef, std::ostream &out) {
+  nef_records::Records records;
+  nef_records::freeze(nef, records);
+  const nef_records::RecordView view = records.view();
+
+  Writer w(out);
+  w.bytes(magic, sizeof(magic));
+  w.value<uint32_t>(version);
+  w.value<uint32_t>(byte_order_mark);
+  w.value<uint32_t>(sizeof(mp_limb_t));
+  w.value<uint32_t>(0);
+  nef_records::forEachArray(
+      view, [&w](const auto &array) { w.value<uint64_t>(array.size); });
+  nef_records::forEachArray(view, [&w](const auto &array) {
+    w.align();
+    w.bytes(array.data, array.size * sizeof(*array.data));
+  });
+}
+
+template <typename Nef> void read(Reader &in, Nef &nef) {
+  if (std::memcmp(in.bytes(sizeof(magic)), magic, sizeof(magic)) != 0) {
+    throw std::runtime_error("Not a binary Nef file");
+  }
+  if (in.value<uint32_t>() != version) {
+    throw std::runtime_error("Unsupported binary Nef version");
+  }
+  if (in.value<uint32_t>() != byte_order_mark ||
+      in.value<uint32_t>() != sizeof(mp_limb_t)) {
+    throw std::runtime_error("Binary Nef file from an incompatible platform");
+  }
+  in.value<uint32_t>();
+
+  nef_records::RecordView view;
+  uint64_t lengths[11];
+  for (auto &length : lengths) length = in.value<uint64_t>();
+  const uint64_t *length = lengths;
+  nef_records::forEachArray(view, [&](auto &array) {
+    using T = std::remove_const_t<std::remove_pointer_t<decltype(array.data)>>;
+    array.size = *length;
+    array.data = in.array<T>(*length++);
+  });
+  nef_records::thaw(view, nef);
+}
+
+} // namespace nef_binary
+
+inline bool isBinaryNefFile(const std::string &filename) {
+  const std::string ext = ".nef3b";
+  return filename.size() >= ext.size() &&
+         filename.compare(filename.size() - ext.size(), ext.size(), ext) == 0;
+}
+
+template <typename Nef>
+bool writeNefBinary(const Nef &nef, const std::string &filename) {
+  std::ofstream out(filename, std::ios::binary);
+  if (!out) {
+    std::cerr << "Error opening file for writing: " << filename << std::endl;
+    return false;
+  }
+  try {
+    nef_binary::write(nef, out);
+  } catch (const std::exception &e) {
+    std::cerr << "Error writing binary Nef file " << filename << ": "
+              << e.what() << std::endl;
+    return false;
+  }
+  return bool(out);
+}
+
+// Reads into a fresh Nef, so nef is only replaced if the file is valid.
+template <typename Nef>
+bool readNefBinary(const std::string &filename, Nef &nef) {
+  nef_binary::MappedFile file(filename);
+  if (!file.data()) {
+    std::cerr << "Cannot open file " << filename << std::endl;
+    return false;
+  }
+  try {
+    Nef result;
+    nef_binary::Reader in(file.data(), file.size());
+    nef_binary::read(in, result);
+    nef = result;
+    return true;
+  } catch (const std::exception &e) {
+    std::cerr << "Error reading binary Nef file " << filename << ": "
+              << e.what() << std::endl;
+    return false;
+  }
+}
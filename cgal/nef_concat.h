@@ -0,0 +1,163 @@
+#pragma once
+
+#include <iterator>
+#include <unordered_map>
+#include <vector>
+
+#include <CGAL/Nef_polyhedron_3.h>
+
+#include "nef_access.h"
+
+namespace nef_concat {
+
+// Maps the handles of a source SNC to their copies. Null handles stay null,
+// and the end of a source list maps to the end of the result's list.
+template <typename Handle> struct HandleMap {
+  std::unordered_map<const void *, Handle> copies;
+
+  template <typename SourceHandle, typename SourceEnd>
+  Handle operator()(const SourceHandle &h, const SourceEnd &source_end,
+                    const Handle &end) const {
+    if (h == SourceHandle()) return Handle();
+    if (h == source_end) return end;
+    return copies.at(&*h);
+  }
+};
+
+} // namespace nef_concat
+
+// Combines Nef polyhedra into one by copying their SNC structures side by side,
+// without an overlay. Only valid if the parts are bounded (their outer volume
+// is unmarked) and pairwise disjoint, including their boundaries, e.g. because
+// their bounding boxes don't touch. The outer volumes are merged into one.
+template <typename Nef> Nef concatenateDisjointNefs(const std::vector<Nef> &parts) {
+  using SNC_structure = typename NefAccess<Nef>::SNC_structure;
+  using Vertex_handle = typename SNC_structure::Vertex_handle;
+  using Halfedge_handle = typename SNC_structure::Halfedge_handle;
+  using Halffacet_handle = typename SNC_structure::Halffacet_handle;
+  using Volume_handle = typename SNC_structure::Volume_handle;
+  using SHalfedge_handle = typename SNC_structure::SHalfedge_handle;
+  using SHalfloop_handle = typename SNC_structure::SHalfloop_handle;
+  using SFace_handle = typename SNC_structure::SFace_handle;
+  using nef_concat::HandleMap;
+
+  if (parts.size() == 1) return parts.front();
+
+  Nef result;
+  SNC_structure &snc = NefAccess<Nef>::structure(result);
+  snc.clear();
+  const Volume_handle outer = snc.new_volume_only();
+  outer->mark() = false;
+
+  for (const Nef &part : parts) {
+    const SNC_structure &src = NefAccess<Nef>::structure(part);
+    HandleMap<Vertex_handle> vertices;
+    HandleMap<Halfedge_handle> halfedges;
+    HandleMap<Halffacet_handle> halffacets;
+    HandleMap<Volume_handle> volumes;
+    HandleMap<SHalfedge_handle> shalfedges;
+    HandleMap<SHalfloop_handle> shalfloops;
+    HandleMap<SFace_handle> sfaces;
+
+    for (auto v = src.vertices_begin(); v != src.vertices_end(); ++v)
+      vertices.copies[&*v] = snc.new_vertex_only();
+    for (auto e = src.halfedges_begin(); e != src.halfedges_end(); ++e)
+      halfedges.copies[&*e] = snc.new_halfedge_only();
+    for (auto f = src.halffacets_begin(); f != src.halffacets_end(); ++f)
+      halffacets.copies[&*f] = snc.new_halffacet_only();
+    volumes.copies[&*src.volumes_begin()] = outer;
+    for (auto c = std::next(src.volumes_begin()); c != src.volumes_end(); ++c)
+      volumes.copies[&*c] = snc.new_volume_only();
+    for (auto se = src.shalfedges_begin(); se != src.shalfedges_end(); ++se)
+      shalfedges.copies[&*se] = snc.new_shalfedge_only();
+    for (auto sl = src.shalfloops_begin(); sl != src.shalfloops_end(); ++sl)
+      shalfloops.copies[&*sl] = snc.new_shalfloop_only();
+    for (auto sf = src.sfaces_begin(); sf != src.sfaces_end(); ++sf)
+      sfaces.copies[&*sf] = snc.new_sface_only();
+
+    auto copyEntry = [&](const CGAL::Object &o) {
+      SHalfedge_handle se;
+      SHalfloop_handle sl;
+      Halfedge_handle sv;
+      SFace_handle sf;
+      if (CGAL::assign(se, o)) return CGAL::make_object(shalfedges.copies.at(&*se));
+      if (CGAL::assign(sl, o)) return CGAL::make_object(shalfloops.copies.at(&*sl));
+      if (CGAL::assign(sv, o)) return CGAL::make_object(halfedges.copies.at(&*sv));
+      CGAL::assign(sf, o);
+      return CGAL::make_object(sfaces.copies.at(&*sf));
+    };
+
+    for (auto v = src.vertices_begin(); v != src.vertices_end(); ++v) {
+      Vertex_handle nv = vertices.copies.at(&*v);
+      nv->sncp() = &snc;
+      nv->point() = v->point();
+      nv->mark() = v->mark();
+      nv->svertices_begin() = halfedges(v->svertices_begin(), src.halfedges_end(), snc.halfedges_end());
+      nv->svertices_last() = halfedges(v->svertices_last(), src.halfedges_end(), snc.halfedges_end());
+      nv->shalfedges_begin() = shalfedges(v->shalfedges_begin(), src.shalfedges_end(), snc.shalfedges_end());
+      nv->shalfedges_last() = shalfedges(v->shalfedges_last(), src.shalfedges_end(), snc.shalfedges_end());
+      nv->sfaces_begin() = sfaces(v->sfaces_begin(), src.sfaces_end(), snc.sfaces_end());
+      nv->sfaces_last() = sfaces(v->sfaces_last(), src.sfaces_end(), snc.sfaces_end());
+      nv->shalfloop() = shalfloops(v->shalfloop(), src.shalfloops_end(), snc.shalfloops_end());
+    }
+    for (auto e = src.halfedges_begin(); e != src.halfedges_end(); ++e) {
+      Halfedge_handle ne = halfedges.copies.at(&*e);
+      ne->point() = e->point();
+      ne->mark() = e->mark();
+      ne->twin() = halfedges(e->twin(), src.halfedges_end(), snc.halfedges_end());
+      ne->center_vertex() = vertices(e->center_vertex(), src.vertices_end(), snc.vertices_end());
+      ne->out_sedge() = shalfedges(e->out_sedge(), src.shalfedges_end(), snc.shalfedges_end());
+      ne->incident_sface() = sfaces(e->incident_sface(), src.sfaces_end(), snc.sfaces_end());
+      copyItemIndex(*ne, *e, 0);
+    }
+    for (auto f = src.halffacets_begin(); f != src.halffacets_end(); ++f) {
+      Halffacet_handle nf = halffacets.copies.at(&*f);
+      nf->plane() = f->plane();
+      nf->mark() = f->mark();
+      nf->twin() = halffacets(f->twin(), src.halffacets_end(), snc.halffacets_end());
+      nf->incident_volume() = volumes(f->incident_volume(), src.volumes_end(), snc.volumes_end());
+      for (const auto &o : f->boundary_entry_objects())
+        nf->boundary_entry_objects().push_back(copyEntry(o));
+    }
+    for (auto c = src.volumes_begin(); c != src.volumes_end(); ++c) {
+      Volume_handle nc = volumes.copies.at(&*c);
+      if (nc != outer) nc->mark() = c->mark();
+      for (const auto &o : c->shell_entry_objects())
+        nc->shell_entry_objects().push_back(copyEntry(o));
+    }
+    for (auto se = src.shalfedges_begin(); se != src.shalfedges_end(); ++se) {
+      SHalfedge_handle nse = shalfedges.copies.at(&*se);
+      nse->circle() = se->circle();
+      nse->mark() = se->mark();
+      nse->twin() = shalfedges(se->twin(), src.shalfedges_end(), snc.shalfedges_end());
+      nse->sprev() = shalfedges(se->sprev(), src.shalfedges_end(), snc.shalfedges_end());
+      nse->snext() = shalfedges(se->snext(), src.shalfedges_end(), snc.shalfedges_end());
+      nse->source() = halfedges(se->source(), src.halfedges_end(), snc.halfedges_end());
+      nse->incident_sface() = sfaces(se->incident_sface(), src.sfaces_end(), snc.sfaces_end());
+      nse->prev() = shalfedges(se->prev(), src.shalfedges_end(), snc.shalfedges_end());
+      nse->next() = shalfedges(se->next(), src.shalfedges_end(), snc.shalfedges_end());
+      nse->facet() = halffacets(se->facet(), src.halffacets_end(), snc.halffacets_end());
+      copyItemIndex(*nse, *se, 0);
+    }
+    for (auto sl = src.shalfloops_begin(); sl != src.shalfloops_end(); ++sl) {
+      SHalfloop_handle nsl = shalfloops.copies.at(&*sl);
+      nsl->circle() = sl->circle();
+      nsl->mark() = sl->mark();
+      nsl->twin() = shalfloops(sl->twin(), src.shalfloops_end(), snc.shalfloops_end());
+      nsl->incident_sface() = sfaces(sl->incident_sface(), src.sfaces_end(), snc.sfaces_end());
+      nsl->facet() = halffacets(sl->facet(), src.halffacets_end(), snc.halffacets_end());
+      copyItemIndex(*nsl, *sl, 0);
+    }
+    for (auto sf = src.sfaces_begin(); sf != src.sfaces_end(); ++sf) {
+      SFace_handle nsf = sfaces.copies.at(&*sf);
+      nsf->mark() = sf->mark();
+      nsf->center_vertex() = vertices(sf->center_vertex(), src.vertices_end(), snc.vertices_end());
+      nsf->volume() = volumes(sf->volume(), src.volumes_end(), snc.volumes_end());
+      for (const auto &o : sf->boundary_entry_objects())
+        nsf->boundary_entry_objects().push_back(copyEntry(o));
+    }
+  }
+
+  NefAccess<Nef>::locator(result)->initialize(&snc);
+  return result;
+}
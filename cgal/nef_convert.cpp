@@ -0,0 +1,81 @@
+/*
+
+Convert a Nef polyhedron between the text (.nef3) and binary (.nef3b)
+formats, based on the file extensions, and report read and write times.
+
+With --verify, the written file is read back and compared to the input.
+With --gmp-alloc, GMP allocations go through the pooled gmp_allocator, and
+its totals are printed at the end.
+
+Usage: nef_convert [--verify] [--gmp-alloc] <input.nef3|input.nef3b> <output.nef3|output.nef3b>
+
+ */
+
+#include <iostream>
+#include <string>
+
+#include <CGAL/Real_timer.h>
+
+#include "cgal_tools.h"
+
+int main(int argc, char *argv[]) {
+  bool verify = false;
+  bool gmp_alloc = false;
+  std::string input, output;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--verify") {
+      verify = true;
+    } else if (arg == "--gmp-alloc") {
+      gmp_alloc = true;
+    } else if (input.empty()) {
+      input = arg;
+    } else if (output.empty()) {
+      output = arg;
+    } else {
+      input.clear();
+      break;
+    }
+  }
+  if (input.empty() || output.empty()) {
+    std::cerr << "Usage: " << argv[0]
+              << " [--verify] [--gmp-alloc] <input.nef3|input.nef3b>"
+                 " <output.nef3|output.nef3b>"
+              << std::endl;
+    return 1;
+  }
+  if (gmp_alloc) gmp_allocator::install();
+
+  CGAL::Real_timer t;
+  CGAL_Nef_polyhedron3 nef;
+  t.start();
+  readNef(input, nef);
+  t.stop();
+  std::cout << "Read " << input << " in " << t.time() * 1000 << " ms ("
+            << nef.number_of_vertices() << " vertices, "
+            << nef.number_of_facets() << " facets)" << std::endl;
+
+  t.reset();
+  t.start();
+  writeNef(nef, output);
+  t.stop();
+  std::cout << "Wrote " << output << " in " << t.time() * 1000 << " ms"
+            << std::endl;
+
+  if (verify) {
+    CGAL_Nef_polyhedron3 round_trip;
+    t.reset();
+    t.start();
+    readNef(output, round_trip);
+    t.stop();
+    std::cout << "Read back " << output << " in " << t.time() * 1000 << " ms"
+              << std::endl;
+    if (!(round_trip == nef)) {
+      std::cerr << "Round trip mismatch" << std::endl;
+      return 1;
+    }
+    std::cout << "Round trip OK" << std::endl;
+  }
+  if (gmp_alloc) gmp_allocator::printStats(std::cerr);
+  return 0;
+}
@@ -0,0 +1,575 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <gmp.h>
+
+#include <CGAL/Gmpq.h>
+#include <CGAL/Nef_polyhedron_3.h>
+
+#include "nef_access.h"
+
+/*
+  Index based records of a Selective Nef Complex, shared by the binary file
+  format (nef_binary_io.h) and NefSnapshot (nef_snapshot.h).
+
+  freeze() walks the SNC once: Every element becomes a record in the flat
+  array of its kind (vertices, halfedges, facets, volumes, shalfedges,
+  shalfloops, sfaces, the order of the text format), handles become int32
+  indices into those arrays, and the boundary and shell lists become runs in
+  one entry array. Every distinct exact number is stored once, as raw GMP
+  limbs in a shared pool, so equal coordinates (and equal numerators or
+  denominators) cost an index each.
+
+  thaw() builds a live Nef from a RecordView, which points either into
+  Records or into a mapped file. It checks every index, so corrupt input
+  throws std::runtime_error instead of building a broken SNC. freeze() throws
+  std::runtime_error likewise if the SNC is too large for the record fields:
+  more than 2^31 elements of a kind, 2^30 sphere items of a kind in boundary
+  entries, or 2^32 entries, numbers or limbs.
+
+  All record fields are 4 bytes wide, so records have no padding and can be
+  written and mapped as they are.
+
+  Only kernels with Gmpq coordinates (e.g. Cartesian<Gmpq>) are supported.
+*/
+namespace nef_records {
+
+constexpr int32_t null_handle = -1;
+constexpr int32_t end_handle = -2;
+
+// Types of the entries in facet, volume and sface boundary lists.
+enum EntryType : uint32_t { SHalfedgeEntry, SHalfloopEntry, SVertexEntry, SFaceEntry };
+
+// Boundary and shell entries: index << 2 | EntryType.
+using Entry = uint32_t;
+
+// References are indices (or null_handle / end_handle), numbers are indices
+// of pooled Rationals.
+struct Vertex {
+  int32_t svertices_begin, svertices_last, shalfedges_begin, shalfedges_last,
+      sfaces_begin, sfaces_last, shalfloop;
+  uint32_t point[3];
+  uint32_t mark;
+};
+struct Halfedge {
+  int32_t twin, center_vertex, out_sedge, incident_sface;
+  uint32_t point[3];
+  uint32_t mark;
+};
+struct Halffacet {
+  int32_t twin, incident_volume;
+  uint32_t first_entry, num_entries;
+  uint32_t plane[4];
+  uint32_t mark;
+};
+struct Volume {
+  uint32_t first_entry, num_entries;
+  uint32_t mark;
+};
+struct SHalfedge {
+  int32_t twin, sprev, snext, source, incident_sface, prev, next, facet;
+  uint32_t circle[4];
+  uint32_t mark;
+};
+struct SHalfloop {
+  int32_t twin, incident_sface, facet;
+  uint32_t circle[4];
+  uint32_t mark;
+};
+struct SFace {
+  int32_t center_vertex, volume;
+  uint32_t first_entry, num_entries;
+  uint32_t mark;
+};
+
+// A pooled GMP integer: size limbs at offset in the limb pool, negative size
+// for negative numbers.
+struct Integer {
+  uint32_t offset;
+  int32_t size;
+};
+struct Rational {
+  uint32_t num, den; // indices of pooled integers
+};
+
+static_assert(sizeof(Vertex) == 11 * 4 && sizeof(Halfedge) == 8 * 4 &&
+                  sizeof(Halffacet) == 9 * 4 && sizeof(Volume) == 3 * 4 &&
+                  sizeof(SHalfedge) == 13 * 4 && sizeof(SHalfloop) == 8 * 4 &&
+                  sizeof(SFace) == 5 * 4,
+              "SNC records must not be padded");
+
+template <typename T> struct Span {
+  const T *data = nullptr;
+  size_t size = 0;
+
+  const T *begin() const { return data; }
+  const T *end() const { return data + size; }
+  const T &operator[](size_t i) const { return data[i]; }
+};
+
+struct RecordView {
+  Span<Vertex> vertices;
+  Span<Halfedge> halfedges;
+  Span<Halffacet> halffacets;
+  Span<Volume> volumes;
+  Span<SHalfedge> shalfedges;
+  Span<SHalfloop> shalfloops;
+  Span<SFace> sfaces;
+  Span<Entry> entries;
+  Span<Rational> rationals;
+  Span<Integer> integers;
+  Span<mp_limb_t> limbs;
+};
+
+// Calls f on every array of view, in the order above.
+template <typename View, typename F> void forEachArray(View &view, F &&f) {
+  f(view.vertices);
+  f(view.halfedges);
+  f(view.halffacets);
+  f(view.volumes);
+  f(view.shalfedges);
+  f(view.shalfloops);
+  f(view.sfaces);
+  f(view.entries);
+  f(view.rationals);
+  f(view.integers);
+  f(view.limbs);
+}
+
+struct Records {
+  std::vector<Vertex> vertices;
+  std::vector<Halfedge> halfedges;
+  std::vector<Halffacet> halffacets;
+  std::vector<Volume> volumes;
+  std::vector<SHalfedge> shalfedges;
+  std::vector<SHalfloop> shalfloops;
+  std::vector<SFace> sfaces;
+  std::vector<Entry> entries;
+  std::vector<Rational> rationals;
+  std::vector<Integer> integers;
+  std::vector<mp_limb_t> limbs;
+
+  RecordView view() const {
+    auto span = [](const auto &v) {
+      using T = typename std::decay_t<decltype(v)>::value_type;
+      return Span<T>{v.data(), v.size()};
+    };
+    return {span(vertices),   span(halfedges),  span(halffacets),
+            span(volumes),    span(shalfedges), span(shalfloops),
+            span(sfaces),     span(entries),    span(rationals),
+            span(integers),   span(limbs)};
+  }
+};
+
+// Returns n as a record field, or throws if it is larger than max.
+inline uint32_t narrow(size_t n, size_t max, const char *what) {
+  if (n > max) {
+    throw std::runtime_error(std::string("Too many ") + what +
+                             " for the SNC records");
+  }
+  return uint32_t(n);
+}
+
+// What freeze() saw of the live numbers: coordinates is the number of exact
+// coordinates of all points and planes, live_bytes a lower bound of the
+// memory of the distinct points, planes and numbers behind them.
+struct FreezeStats {
+  size_t coordinates = 0;
+  size_t live_bytes = 0;
+};
+
+// Pools the numbers of one freeze() and measures the live numbers, points
+// and planes they come from. Identical reps are recognised by address, other
+// equal values by their limbs.
+class NumberPool {
+public:
+  explicit NumberPool(Records &records) : r_(records) {}
+
+  template <typename Point> void point(const Point &p, uint32_t (&out)[3]) {
+    geometry(&p.x(), 3);
+    out[0] = number(p.x());
+    out[1] = number(p.y());
+    out[2] = number(p.z());
+  }
+  template <typename Plane> void plane(const Plane &h, uint32_t (&out)[4]) {
+    geometry(&h.a(), 4);
+    out[0] = number(h.a());
+    out[1] = number(h.b());
+    out[2] = number(h.c());
+    out[3] = number(h.d());
+  }
+
+  FreezeStats stats;
+
+private:
+  // Points and planes of reference counted kernels share one rep per value.
+  void geometry(const CGAL::Gmpq *first, size_t n) {
+    stats.coordinates += n;
+    if (geometry_reps_.insert(first).second) {
+      stats.live_bytes += sizeof(size_t) + n * sizeof(CGAL::Gmpq);
+    }
+  }
+
+  uint32_t number(const CGAL::Gmpq &q) {
+    auto [rep, new_rep] = by_rep_.emplace(q.mpq(), 0);
+    if (!new_rep) return rep->second;
+    stats.live_bytes +=
+        sizeof(size_t) + sizeof(mpq_t) +
+        (mpq_numref(q.mpq())->_mp_alloc + mpq_denref(q.mpq())->_mp_alloc) *
+            sizeof(mp_limb_t);
+    const uint64_t key = uint64_t(integer(mpq_numref(q.mpq()))) << 32 |
+                         integer(mpq_denref(q.mpq()));
+    auto [value, new_value] = by_value_.emplace(
+        key, narrow(r_.rationals.size(), UINT32_MAX, "numbers"));
+    if (new_value) {
+      r_.rationals.push_back({uint32_t(key >> 32), uint32_t(key)});
+    }
+    return rep->second = value->second;
+  }
+
+  uint32_t integer(mpz_srcptr z) {
+    const size_t size = mpz_size(z);
+    std::string key(reinterpret_cast<const char *>(mpz_limbs_read(z)),
+                    size * sizeof(mp_limb_t));
+    key.push_back(mpz_sgn(z) < 0 ? '-' : '+');
+    auto [it, inserted] = integers_.emplace(
+        std::move(key), narrow(r_.integers.size(), UINT32_MAX, "integers"));
+    if (inserted) {
+      narrow(r_.limbs.size() + size, UINT32_MAX, "limbs");
+      const int32_t n = int32_t(narrow(size, INT32_MAX, "limbs"));
+      r_.integers.push_back(
+          {uint32_t(r_.limbs.size()), mpz_sgn(z) < 0 ? -n : n});
+      r_.limbs.insert(r_.limbs.end(), mpz_limbs_read(z), mpz_limbs_read(z) + size);
+    }
+    return it->second;
+  }
+
+  Records &r_;
+  std::unordered_set<const void *> geometry_reps_;
+  std::unordered_map<const void *, uint32_t> by_rep_;
+  std::unordered_map<uint64_t, uint32_t> by_value_;
+  std::unordered_map<std::string, uint32_t> integers_;
+};
+
+// Appends the records of nef to the empty records.
+template <typename Nef> FreezeStats freeze(const Nef &nef, Records &records) {
+  using SNC_structure = typename NefAccess<Nef>::SNC_structure;
+  using SHalfedge_handle = typename SNC_structure::SHalfedge_handle;
+  using SHalfloop_handle = typename SNC_structure::SHalfloop_handle;
+  using SVertex_handle = typename SNC_structure::SVertex_handle;
+  using SFace_handle = typename SNC_structure::SFace_handle;
+  static_assert(std::is_same_v<typename SNC_structure::Point_3::FT, CGAL::Gmpq>,
+                "SNC records need a kernel with Gmpq coordinates");
+  const SNC_structure &snc = NefAccess<Nef>::structure(nef);
+
+  std::unordered_map<const void *, int32_t> index;
+  auto enumerate = [&index](auto begin, auto end) {
+    size_t i = 0;
+    for (auto it = begin; it != end; ++it) {
+      index[&*it] = int32_t(narrow(i++, INT32_MAX, "SNC elements"));
+    }
+  };
+  enumerate(snc.vertices_begin(), snc.vertices_end());
+  enumerate(snc.halfedges_begin(), snc.halfedges_end());
+  enumerate(snc.halffacets_begin(), snc.halffacets_end());
+  enumerate(snc.volumes_begin(), snc.volumes_end());
+  enumerate(snc.shalfedges_begin(), snc.shalfedges_end());
+  enumerate(snc.shalfloops_begin(), snc.shalfloops_end());
+  enumerate(snc.sfaces_begin(), snc.sfaces_end());
+
+  auto ref = [&index](const auto &h, const auto &end) -> int32_t {
+    using Handle = std::decay_t<decltype(h)>;
+    if (h == Handle()) return null_handle;
+    if (h == end) return end_handle;
+    return index.at(&*h);
+  };
+  // Entries keep the type in the low two bits.
+  auto entry = [&index](const auto &h, EntryType type) -> Entry {
+    return narrow(index.at(&*h), (1u << 30) - 1, "sphere items") << 2 | type;
+  };
+  // Appends a boundary list; returns its first entry and length.
+  auto entries = [&](const auto &objects, uint32_t &first, uint32_t &n) {
+    first = narrow(records.entries.size(), UINT32_MAX, "boundary entries");
+    for (const auto &o : objects) {
+      SHalfedge_handle se;
+      SHalfloop_handle sl;
+      SVertex_handle sv;
+      SFace_handle sf;
+      if (CGAL::assign(se, o)) {
+        records.entries.push_back(entry(se, SHalfedgeEntry));
+      } else if (CGAL::assign(sl, o)) {
+        records.entries.push_back(entry(sl, SHalfloopEntry));
+      } else if (CGAL::assign(sv, o)) {
+        records.entries.push_back(entry(sv, SVertexEntry));
+      } else if (CGAL::assign(sf, o)) {
+        records.entries.push_back(entry(sf, SFaceEntry));
+      } else {
+        throw std::runtime_error("Unexpected boundary entry");
+      }
+    }
+    n = narrow(records.entries.size(), UINT32_MAX, "boundary entries") - first;
+  };
+
+  NumberPool numbers(records);
+  records.vertices.reserve(snc.number_of_vertices());
+  for (auto v = snc.vertices_begin(); v != snc.vertices_end(); ++v) {
+    Vertex &r = records.vertices.emplace_back();
+    r.svertices_begin = ref(v->svertices_begin(), snc.halfedges_end());
+    r.svertices_last = ref(v->svertices_last(), snc.halfedges_end());
+    r.shalfedges_begin = ref(v->shalfedges_begin(), snc.shalfedges_end());
+    r.shalfedges_last = ref(v->shalfedges_last(), snc.shalfedges_end());
+    r.sfaces_begin = ref(v->sfaces_begin(), snc.sfaces_end());
+    r.sfaces_last = ref(v->sfaces_last(), snc.sfaces_end());
+    r.shalfloop = ref(v->shalfloop(), snc.shalfloops_end());
+    r.mark = v->mark();
+    numbers.point(v->point(), r.point);
+  }
+  records.halfedges.reserve(snc.number_of_halfedges());
+  for (auto e = snc.halfedges_begin(); e != snc.halfedges_end(); ++e) {
+    Halfedge &r = records.halfedges.emplace_back();
+    r.twin = ref(e->twin(), snc.halfedges_end());
+    r.center_vertex = ref(e->center_vertex(), snc.vertices_end());
+    r.out_sedge = ref(e->out_sedge(), snc.shalfedges_end());
+    r.incident_sface = ref(e->incident_sface(), snc.sfaces_end());
+    r.mark = e->mark();
+    numbers.point(e->point(), r.point);
+  }
+  records.halffacets.reserve(snc.number_of_halffacets());
+  for (auto f = snc.halffacets_begin(); f != snc.halffacets_end(); ++f) {
+    Halffacet &r = records.halffacets.emplace_back();
+    r.twin = ref(f->twin(), snc.halffacets_end());
+    r.incident_volume = ref(f->incident_volume(), snc.volumes_end());
+    r.mark = f->mark();
+    entries(f->boundary_entry_objects(), r.first_entry, r.num_entries);
+    numbers.plane(f->plane(), r.plane);
+  }
+  records.volumes.reserve(snc.number_of_volumes());
+  for (auto c = snc.volumes_begin(); c != snc.volumes_end(); ++c) {
+    Volume &r = records.volumes.emplace_back();
+    r.mark = c->mark();
+    entries(c->shell_entry_objects(), r.first_entry, r.num_entries);
+  }
+  records.shalfedges.reserve(snc.number_of_shalfedges());
+  for (auto se = snc.shalfedges_begin(); se != snc.shalfedges_end(); ++se) {
+    SHalfedge &r = records.shalfedges.emplace_back();
+    r.twin = ref(se->twin(), snc.shalfedges_end());
+    r.sprev = ref(se->sprev(), snc.shalfedges_end());
+    r.snext = ref(se->snext(), snc.shalfedges_end());
+    r.source = ref(se->source(), snc.halfedges_end());
+    r.incident_sface = ref(se->incident_sface(), snc.sfaces_end());
+    r.prev = ref(se->prev(), snc.shalfedges_end());
+    r.next = ref(se->next(), snc.shalfedges_end());
+    r.facet = ref(se->facet(), snc.halffacets_end());
+    r.mark = se->mark();
+    numbers.plane(se->circle(), r.circle);
+  }
+  records.shalfloops.reserve(snc.number_of_shalfloops());
+  for (auto sl = snc.shalfloops_begin(); sl != snc.shalfloops_end(); ++sl) {
+    SHalfloop &r = records.shalfloops.emplace_back();
+    r.twin = ref(sl->twin(), snc.shalfloops_end());
+    r.incident_sface = ref(sl->incident_sface(), snc.sfaces_end());
+    r.facet = ref(sl->facet(), snc.halffacets_end());
+    r.mark = sl->mark();
+    numbers.plane(sl->circle(), r.circle);
+  }
+  records.sfaces.reserve(snc.number_of_sfaces());
+  for (auto sf = snc.sfaces_begin(); sf != snc.sfaces_end(); ++sf) {
+    SFace &r = records.sfaces.emplace_back();
+    r.center_vertex = ref(sf->center_vertex(), snc.vertices_end());
+    r.volume = ref(sf->volume(), snc.volumes_end());
+    r.mark = sf->mark();
+    entries(sf->boundary_entry_objects(), r.first_entry, r.num_entries);
+  }
+  return numbers.stats;
+}
+
+// Replaces the SNC of nef by the one recorded in r.
+template <typename Nef> void thaw(const RecordView &r, Nef &nef) {
+  using SNC_structure = typename NefAccess<Nef>::SNC_structure;
+  using Vertex_handle = typename SNC_structure::Vertex_handle;
+  using Halfedge_handle = typename SNC_structure::Halfedge_handle;
+  using Halffacet_handle = typename SNC_structure::Halffacet_handle;
+  using Volume_handle = typename SNC_structure::Volume_handle;
+  using SHalfedge_handle = typename SNC_structure::SHalfedge_handle;
+  using SHalfloop_handle = typename SNC_structure::SHalfloop_handle;
+  using SFace_handle = typename SNC_structure::SFace_handle;
+  using Point_3 = typename SNC_structure::Point_3;
+  using Plane_3 = typename SNC_structure::Plane_3;
+  using Sphere_point = typename SNC_structure::Sphere_point;
+  using Sphere_circle = typename SNC_structure::Sphere_circle;
+  static_assert(std::is_same_v<typename Point_3::FT, CGAL::Gmpq>,
+                "SNC records need a kernel with Gmpq coordinates");
+
+  auto check = [](bool ok, const char *what) {
+    if (!ok) throw std::runtime_error(what);
+  };
+
+  // One Gmpq per distinct number, shared by all coordinates equal to it. The
+  // limbs are used in place through a read-only mpz view, so the only copy
+  // is the one into the Gmpq's own storage.
+  std::vector<CGAL::Gmpq> numbers(r.rationals.size);
+  auto setInteger = [&](mpz_ptr z, uint32_t i) {
+    check(i < r.integers.size, "Number index out of range");
+    const Integer &n = r.integers[i];
+    const uint64_t size = n.size < 0 ? -int64_t(n.size) : n.size;
+    check(n.offset <= r.limbs.size && size <= r.limbs.size - n.offset,
+          "Limb index out of range");
+    mpz_t view;
+    mpz_set(z, mpz_roinit_n(view, r.limbs.data + n.offset, n.size));
+  };
+  for (size_t i = 0; i < numbers.size(); ++i) {
+    setInteger(mpq_numref(numbers[i].mpq()), r.rationals[i].num);
+    setInteger(mpq_denref(numbers[i].mpq()), r.rationals[i].den);
+    check(mpz_sgn(mpq_denref(numbers[i].mpq())) > 0, "Invalid denominator");
+  }
+  auto number = [&](uint32_t i) -> const CGAL::Gmpq & {
+    check(i < numbers.size(), "Number index out of range");
+    return numbers[i];
+  };
+  auto point = [&](const uint32_t(&p)[3]) {
+    return std::array<CGAL::Gmpq, 3>{number(p[0]), number(p[1]), number(p[2])};
+  };
+  auto plane = [&](const uint32_t(&h)[4]) {
+    return Plane_3(number(h[0]), number(h[1]), number(h[2]), number(h[3]));
+  };
+
+  SNC_structure &snc = NefAccess<Nef>::structure(nef);
+  snc.clear();
+  std::vector<Vertex_handle> vertices(r.vertices.size);
+  std::vector<Halfedge_handle> halfedges(r.halfedges.size);
+  std::vector<Halffacet_handle> halffacets(r.halffacets.size);
+  std::vector<Volume_handle> volumes(r.volumes.size);
+  std::vector<SHalfedge_handle> shalfedges(r.shalfedges.size);
+  std::vector<SHalfloop_handle> shalfloops(r.shalfloops.size);
+  std::vector<SFace_handle> sfaces(r.sfaces.size);
+  for (auto &h : vertices) h = snc.new_vertex_only();
+  for (auto &h : halfedges) h = snc.new_halfedge_only();
+  for (auto &h : halffacets) h = snc.new_halffacet_only();
+  for (auto &h : volumes) h = snc.new_volume_only();
+  for (auto &h : shalfedges) h = snc.new_shalfedge_only();
+  for (auto &h : shalfloops) h = snc.new_shalfloop_only();
+  for (auto &h : sfaces) h = snc.new_sface_only();
+
+  auto at = [&check](const auto &table, uint32_t i) {
+    check(i < table.size(), "Index out of range");
+    return table[i];
+  };
+  auto ref = [&at](const auto &table, const auto &end, int32_t i) {
+    using Handle = typename std::decay_t<decltype(table)>::value_type;
+    if (i == null_handle) return Handle();
+    if (i == end_handle) return Handle(end);
+    return at(table, uint32_t(i));
+  };
+  // Appends a boundary list whose entry types are in the allowed bit set.
+  auto entries = [&](auto &objects, uint32_t first, uint32_t n,
+                     uint32_t allowed, const char *what) {
+    check(first <= r.entries.size && n <= r.entries.size - first,
+          "Entry index out of range");
+    for (uint32_t k = first; k < first + n; ++k) {
+      const uint32_t type = r.entries[k] & 3, i = r.entries[k] >> 2;
+      check(allowed & (1u << type), what);
+      switch (type) {
+      case SHalfedgeEntry:
+        objects.push_back(CGAL::make_object(at(shalfedges, i)));
+        break;
+      case SHalfloopEntry:
+        objects.push_back(CGAL::make_object(at(shalfloops, i)));
+        break;
+      case SVertexEntry:
+        objects.push_back(CGAL::make_object(at(halfedges, i)));
+        break;
+      case SFaceEntry:
+        objects.push_back(CGAL::make_object(at(sfaces, i)));
+        break;
+      }
+    }
+  };
+  constexpr uint32_t loops = 1u << SHalfedgeEntry | 1u << SHalfloopEntry;
+
+  for (size_t i = 0; i < vertices.size(); ++i) {
+    const Vertex &rec = r.vertices[i];
+    Vertex_handle v = vertices[i];
+    v->sncp() = &snc;
+    v->svertices_begin() = ref(halfedges, snc.halfedges_end(), rec.svertices_begin);
+    v->svertices_last() = ref(halfedges, snc.halfedges_end(), rec.svertices_last);
+    v->shalfedges_begin() = ref(shalfedges, snc.shalfedges_end(), rec.shalfedges_begin);
+    v->shalfedges_last() = ref(shalfedges, snc.shalfedges_end(), rec.shalfedges_last);
+    v->sfaces_begin() = ref(sfaces, snc.sfaces_end(), rec.sfaces_begin);
+    v->sfaces_last() = ref(sfaces, snc.sfaces_end(), rec.sfaces_last);
+    v->shalfloop() = ref(shalfloops, snc.shalfloops_end(), rec.shalfloop);
+    v->mark() = rec.mark != 0;
+    const auto p = point(rec.point);
+    v->point() = Point_3(p[0], p[1], p[2]);
+  }
+  for (size_t i = 0; i < halfedges.size(); ++i) {
+    const Halfedge &rec = r.halfedges[i];
+    Halfedge_handle e = halfedges[i];
+    e->twin() = ref(halfedges, snc.halfedges_end(), rec.twin);
+    e->center_vertex() = ref(vertices, snc.vertices_end(), rec.center_vertex);
+    e->out_sedge() = ref(shalfedges, snc.shalfedges_end(), rec.out_sedge);
+    e->incident_sface() = ref(sfaces, snc.sfaces_end(), rec.incident_sface);
+    e->mark() = rec.mark != 0;
+    const auto p = point(rec.point);
+    e->point() = Sphere_point(p[0], p[1], p[2]);
+  }
+  for (size_t i = 0; i < halffacets.size(); ++i) {
+    const Halffacet &rec = r.halffacets[i];
+    Halffacet_handle f = halffacets[i];
+    f->twin() = ref(halffacets, snc.halffacets_end(), rec.twin);
+    f->incident_volume() = ref(volumes, snc.volumes_end(), rec.incident_volume);
+    f->mark() = rec.mark != 0;
+    entries(f->boundary_entry_objects(), rec.first_entry, rec.num_entries,
+            loops, "Unexpected facet boundary entry");
+    f->plane() = plane(rec.plane);
+  }
+  for (size_t i = 0; i < volumes.size(); ++i) {
+    const Volume &rec = r.volumes[i];
+    volumes[i]->mark() = rec.mark != 0;
+    entries(volumes[i]->shell_entry_objects(), rec.first_entry,
+            rec.num_entries, 1u << SFaceEntry, "Unexpected volume shell entry");
+  }
+  for (size_t i = 0; i < shalfedges.size(); ++i) {
+    const SHalfedge &rec = r.shalfedges[i];
+    SHalfedge_handle se = shalfedges[i];
+    se->twin() = ref(shalfedges, snc.shalfedges_end(), rec.twin);
+    se->sprev() = ref(shalfedges, snc.shalfedges_end(), rec.sprev);
+    se->snext() = ref(shalfedges, snc.shalfedges_end(), rec.snext);
+    se->source() = ref(halfedges, snc.halfedges_end(), rec.source);
+    se->incident_sface() = ref(sfaces, snc.sfaces_end(), rec.incident_sface);
+    se->prev() = ref(shalfedges, snc.shalfedges_end(), rec.prev);
+    se->next() = ref(shalfedges, snc.shalfedges_end(), rec.next);
+    se->facet() = ref(halffacets, snc.halffacets_end(), rec.facet);
+    se->mark() = rec.mark != 0;
+    se->circle() = Sphere_circle(plane(rec.circle));
+  }
+  for (size_t i = 0; i < shalfloops.size(); ++i) {
+    const SHalfloop &rec = r.shalfloops[i];
+    SHalfloop_handle sl = shalfloops[i];
+    sl->twin() = ref(shalfloops, snc.shalfloops_end(), rec.twin);
+    sl->incident_sface() = ref(sfaces, snc.sfaces_end(), rec.incident_sface);
+    sl->facet() = ref(halffacets, snc.halffacets_end(), rec.facet);
+    sl->mark() = rec.mark != 0;
+    sl->circle() = Sphere_circle(plane(rec.circle));
+  }
+  for (size_t i = 0; i < sfaces.size(); ++i) {
+    const SFace &rec = r.sfaces[i];
+    SFace_handle sf = sfaces[i];
+    sf->center_vertex() = ref(vertices, snc.vertices_end(), rec.center_vertex);
+    sf->volume() = ref(volumes, snc.volumes_end(), rec.volume);
+    sf->mark() = rec.mark != 0;
+    entries(sf->boundary_entry_objects(), rec.first_entry, rec.num_entries,
+            loops | 1u << SVertexEntry, "Unexpected sface boundary entry");
+  }
+
+  NefAccess<Nef>::locator(nef)->initialize(&snc);
+}
+
+} // namespace nef_records
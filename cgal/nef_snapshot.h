@@ -0,0 +1,114 @@
+#pragma once
+
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <gmp.h>
+
+#include <CGAL/Object.h>
+
+#include "nef_access.h"
+#include "nef_records.h"
+
+// Live and snapshot memory of one kind of SNC element, see
+// NefSnapshot::memory().
+struct NefMemoryRow {
+  std::string name;
+  size_t count = 0;
+  size_t live_bytes = 0;
+  size_t snapshot_bytes = 0;
+};
+
+// Frozen, read-only copy of a Nef polyhedron for caching many finished
+// results: The SNC is stored as the index based records of nef_records.h,
+// the same ones the binary format writes, so every distinct exact number is
+// stored once and equal coordinates (and equal numerators or denominators)
+// cost an index each. thaw() builds a live Nef from it again; the cost is
+// about that of reading a binary Nef file.
+//
+// Only kernels with Gmpq coordinates (e.g. Cartesian<Gmpq>) are supported.
+template <typename Nef> class NefSnapshot {
+public:
+  explicit NefSnapshot(const Nef &nef);
+
+  Nef thaw() const {
+    Nef nef;
+    nef_records::thaw(records_.view(), nef);
+    return nef;
+  }
+
+  // Bytes per kind of element, live (when frozen) and in the snapshot. Live
+  // bytes are a lower bound: the SNC items with their embedded handles, the
+  // nodes of the boundary lists, and each distinct shared point, plane and
+  // number with its allocated limbs; allocator overhead is not counted.
+  const std::vector<NefMemoryRow> &memory() const { return memory_; }
+
+  size_t liveBytes() const { return total(&NefMemoryRow::live_bytes); }
+  size_t snapshotBytes() const { return total(&NefMemoryRow::snapshot_bytes); }
+
+  void printMemory(std::ostream &out) const;
+
+private:
+  size_t total(size_t NefMemoryRow::*field) const {
+    size_t bytes = 0;
+    for (const auto &row : memory_) bytes += row.*field;
+    return bytes;
+  }
+
+  nef_records::Records records_;
+  std::vector<NefMemoryRow> memory_;
+};
+
+template <typename Nef> NefSnapshot<Nef>::NefSnapshot(const Nef &nef) {
+  const nef_records::FreezeStats stats = nef_records::freeze(nef, records_);
+  records_.entries.shrink_to_fit();
+  records_.rationals.shrink_to_fit();
+  records_.integers.shrink_to_fit();
+  records_.limbs.shrink_to_fit();
+
+  const auto &snc = NefAccess<Nef>::structure(nef);
+  auto row = [&](const char *name, const auto &records, size_t item_bytes) {
+    using Record = typename std::decay_t<decltype(records)>::value_type;
+    memory_.push_back({name, records.size(), records.size() * item_bytes,
+                       records.size() * sizeof(Record)});
+  };
+  row("vertices", records_.vertices, sizeof(*snc.vertices_begin()));
+  row("halfedges", records_.halfedges, sizeof(*snc.halfedges_begin()));
+  row("halffacets", records_.halffacets, sizeof(*snc.halffacets_begin()));
+  row("volumes", records_.volumes, sizeof(*snc.volumes_begin()));
+  row("shalfedges", records_.shalfedges, sizeof(*snc.shalfedges_begin()));
+  row("shalfloops", records_.shalfloops, sizeof(*snc.shalfloops_begin()));
+  row("sfaces", records_.sfaces, sizeof(*snc.sfaces_begin()));
+  // std::list nodes holding a CGAL::Object, whose own heap holder is not
+  // counted.
+  row("boundary entries", records_.entries,
+      2 * sizeof(void *) + sizeof(CGAL::Object));
+  memory_.push_back(
+      {"coordinates", stats.coordinates, stats.live_bytes,
+       records_.rationals.size() * sizeof(nef_records::Rational) +
+           records_.integers.size() * sizeof(nef_records::Integer) +
+           records_.limbs.size() * sizeof(mp_limb_t)});
+}
+
+template <typename Nef>
+void NefSnapshot<Nef>::printMemory(std::ostream &out) const {
+  auto perElement = [](size_t bytes, size_t count) {
+    return count ? double(bytes) / count : 0.0;
+  };
+  out << std::left << std::setw(18) << "element" << std::right
+      << std::setw(10) << "count" << std::setw(12) << "live B/el"
+      << std::setw(14) << "snapshot B/el" << std::endl;
+  for (const auto &row : memory_) {
+    out << std::left << std::setw(18) << row.name << std::right
+        << std::setw(10) << row.count << std::fixed << std::setprecision(1)
+        << std::setw(12) << perElement(row.live_bytes, row.count)
+        << std::setw(14) << perElement(row.snapshot_bytes, row.count)
+        << std::defaultfloat << std::endl;
+  }
+  const size_t live = liveBytes(), frozen = snapshotBytes();
+  out << "total: " << live << " bytes live, " << frozen << " bytes frozen ("
+      << (frozen ? double(live) / frozen : 0.0) << "x smaller)" << std::endl;
+}
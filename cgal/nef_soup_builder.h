@@ -0,0 +1,128 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <CGAL/Nef_polyhedron_3.h>
+
+// Builds a Nef polyhedron directly from a triangle soup, the way the Nef
+// constructor from a polygon mesh does, but with the soup's halfedge pairing
+// in place of the mesh: Every vertex gets a sphere map made of one shalfedge
+// per incident triangle, on the circle of the triangle's exact plane, and
+// CGAL's external structure then adds edges, facets and volumes.
+//
+// Halfedge 3 * f + k runs from corner k to corner k + 1 of triangle f, and
+// mate[h] is its opposite halfedge, or no_mate on a border. The soup must be
+// manifold (one fan of triangles per vertex), must not self-intersect, and
+// must not have degenerate triangles. Triangles with solid[f] set belong to a
+// closed shell and bound a solid; all others are included as surfaces.
+template <typename Nef> class NefSoupBuilder : public Nef {
+public:
+  using SNC_structure = typename Nef::SNC_structure;
+  using SM_decorator = typename SNC_structure::SM_decorator;
+  using Vertex_handle = typename SNC_structure::Vertex_handle;
+  using SVertex_handle = typename SNC_structure::SVertex_handle;
+  using SHalfedge_handle = typename SNC_structure::SHalfedge_handle;
+  using SFace_handle = typename SNC_structure::SFace_handle;
+  using Sphere_point = typename SNC_structure::Sphere_point;
+  using Sphere_circle = typename SNC_structure::Sphere_circle;
+  using Point_3 = typename Nef::Point_3;
+  using Vector_3 = typename Nef::Vector_3;
+  using Plane_3 = typename Nef::Plane_3;
+
+  static constexpr uint32_t no_mate = std::numeric_limits<uint32_t>::max();
+
+  NefSoupBuilder(const std::vector<Point_3> &points,
+                 const std::vector<std::array<uint32_t, 3>> &triangles,
+                 const std::vector<uint32_t> &mate,
+                 const std::vector<char> &solid) {
+    SNC_structure &snc = this->snc();
+    snc.clear();
+
+    std::vector<Sphere_circle> circles;
+    circles.reserve(triangles.size());
+    for (const auto &t : triangles) {
+      const Vector_3 normal = CGAL::cross_product(points[t[1]] - points[t[0]],
+                                                  points[t[2]] - points[t[0]]);
+      circles.push_back(normalized(Sphere_circle(Plane_3(CGAL::ORIGIN, normal))));
+    }
+
+    auto vertexAt = [&triangles](uint32_t c) { return triangles[c / 3][c % 3]; };
+    auto next = [](uint32_t c) { return c - c % 3 + (c + 1) % 3; };
+    auto prev = [](uint32_t c) { return c - c % 3 + (c + 2) % 3; };
+
+    std::vector<char> done(3 * triangles.size(), false);
+    std::vector<uint32_t> fan;
+    for (uint32_t c0 = 0; c0 < done.size(); ++c0) {
+      if (done[c0]) continue;
+      // Go back to the start of an open fan; corner c and halfedge c share
+      // their source vertex.
+      uint32_t start = c0;
+      while (mate[prev(start)] != no_mate && mate[prev(start)] != c0) {
+        start = mate[prev(start)];
+      }
+      bool closed = true;
+      fan.clear();
+      for (uint32_t c = start;;) {
+        fan.push_back(c);
+        done[c] = true;
+        if (mate[c] == no_mate) {
+          closed = false;
+          break;
+        }
+        c = next(mate[c]);
+        if (c == start) break;
+      }
+      addSphereMap(points, vertexAt, next, prev, fan, closed, circles, solid);
+    }
+
+    this->build_external_structure();
+    this->simplify();
+  }
+
+private:
+  // Sphere map of the vertex of the fan's corners. Shalfedges run from the
+  // direction of each triangle's previous vertex to that of its next one, as
+  // in polygon_mesh_to_nef_3(), so the sface left of them is outside.
+  template <typename VertexAt, typename Next, typename Prev>
+  void addSphereMap(const std::vector<Point_3> &points, VertexAt vertexAt,
+                    Next next, Prev prev, const std::vector<uint32_t> &fan,
+                    bool closed, const std::vector<Sphere_circle> &circles,
+                    const std::vector<char> &solid) {
+    const Point_3 &p = points[vertexAt(fan.front())];
+    Vertex_handle v = this->snc().new_vertex();
+    v->point() = p;
+    v->mark() = true;
+    SM_decorator SM(&*v);
+    auto newSVertex = [&](uint32_t w) {
+      SVertex_handle sv = SM.new_svertex(Sphere_point(CGAL::ORIGIN + (points[w] - p)));
+      sv->mark() = true;
+      return sv;
+    };
+
+    const SVertex_handle sv_0 = newSVertex(vertexAt(prev(fan.front())));
+    SVertex_handle sv_prev = sv_0;
+    SHalfedge_handle e;
+    for (size_t i = 0; i < fan.size(); ++i) {
+      const SVertex_handle sv = closed && i + 1 == fan.size()
+                                    ? sv_0
+                                    : newSVertex(vertexAt(next(fan[i])));
+      e = SM.new_shalfedge_pair(sv_prev, sv);
+      e->circle() = circles[fan[i] / 3];
+      e->twin()->circle() = e->circle().opposite();
+      e->mark() = e->twin()->mark() = true;
+      sv_prev = sv;
+    }
+
+    SFace_handle outside = SM.new_sface();
+    SM.link_as_face_cycle(e, outside);
+    outside->mark() = false;
+    if (closed) {
+      SFace_handle inside = SM.new_sface();
+      SM.link_as_face_cycle(e->twin(), inside);
+      inside->mark() = solid[fan.front() / 3];
+    }
+  }
+};
@@ -3,10 +3,14 @@
 Read an OFF file and
 Try to convert to a Nef Polyhedron.
 
+With --gmp-alloc, GMP allocations go through the pooled gmp_allocator, and
+its totals are printed at the end.
+
  */
 
 #include <iostream>
 #include <fstream>
+#include <string>
 #include <vector>
 #include <CGAL/Surface_mesh/Surface_mesh.h>
 #include <CGAL/Nef_polyhedron_3.h>
@@ -17,6 +21,8 @@ Try to convert to a Nef Polyhedron.
 #undef NDEBUG
 #include <CGAL/IO/Nef_polyhedron_iostream_3.h>
 #pragma pop_macro("NDEBUG")
+#include "gmp_allocator.h"
+#include "nef_binary_io.h"
 
 using Kernel = CGAL::Cartesian<CGAL::Gmpq>;
 using Nef_polyhedron = CGAL::Nef_polyhedron_3<Kernel>;
@@ -24,10 +30,18 @@ using Vertex = Kernel::Point_3;
 
 int main(int argc, char *argv[])
 {
+  const char *program = argv[0];
+  const bool gmp_alloc = argc > 1 && std::string(argv[1]) == "--gmp-alloc";
+  if (gmp_alloc) {
+    // Drop the flag, so the file names stay at argv[1] and argv[2].
+    argv++;
+    argc--;
+  }
   if (argc != 3) {
-    std::cerr << "Usage: " << argv[0] << " <input.off> <output.nef3>" << std::endl;
+    std::cerr << "Usage: " << program << " [--gmp-alloc] <input.off> <output.nef3|output.nef3b>" << std::endl;
     return 1;
   }
+  if (gmp_alloc) gmp_allocator::install();
 
   using SurfaceMesh = CGAL::Surface_mesh<Vertex>;
   SurfaceMesh mesh;
@@ -47,13 +61,18 @@ int main(int argc, char *argv[])
     Nef_polyhedron nef(mesh);
     std::cout << "Successfully created Nef polyhedron from " << argv[1] << std::endl;
 
-    std::ofstream output(argv[2]);
-    if (!output) {
-      std::cerr << "Cannot open file for writing " << argv[2] << std::endl;
-      return 1;
+    if (isBinaryNefFile(argv[2])) {
+      if (!writeNefBinary(nef, argv[2])) return 1;
+    } else {
+      std::ofstream output(argv[2]);
+      if (!output) {
+        std::cerr << "Cannot open file for writing " << argv[2] << std::endl;
+        return 1;
+      }
+      output << nef;
     }
-    output << nef;
     std::cout << "Successfully wrote Nef polyhedron to " << argv[2] << std::endl;
+    if (gmp_alloc) gmp_allocator::printStats(std::cerr);
   } catch (const CGAL::Assertion_exception& e) {
     std::cerr << "CGAL assertion while creating Nef polyhedron: " << e.what() << std::endl;
     return 1;
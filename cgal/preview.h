@@ -0,0 +1,173 @@
+#pragma once
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <CGAL/Polygon_mesh_processing/self_intersections.h>
+#include <CGAL/Surface_mesh.h>
+#include <CGAL/convex_hull_3.h>
+
+#include "cgal_tools.h"
+
+// A stage of previewDecomposition(). If guaranteed is false, the exact
+// pipeline may produce something else at this stage; note says why.
+struct PreviewStage {
+  std::string name;
+  double ms = 0;
+  bool guaranteed = true;
+  std::string note;
+};
+
+struct Preview {
+  std::vector<Epick_SurfaceMesh> hulls; // one per part
+  std::vector<PreviewStage> stages;
+
+  bool guaranteed() const {
+    for (const auto &stage : stages) {
+      if (!stage.guaranteed) return false;
+    }
+    return true;
+  }
+};
+
+// Whether a triangle soup is the closed boundary of one convex solid: No
+// edge may be reflex, tested with exact predicates like isConvexNef().
+// Assumes the soup is connected and does not self-intersect.
+inline bool isConvexShell(const Object &shell,
+                          const std::vector<Epick_Point3> &points) {
+  std::vector<uint32_t> mate;
+  size_t boundary_edges, non_manifold_edges;
+  pairHalfedges(shell.indices, mate, boundary_edges, non_manifold_edges);
+  if (boundary_edges > 0 || non_manifold_edges > 0) return false;
+  auto vertexAt = [&shell](uint32_t c) { return shell.indices[c / 3][c % 3]; };
+  auto next = [](uint32_t c) { return c - c % 3 + (c + 1) % 3; };
+  auto prev = [](uint32_t c) { return c - c % 3 + (c + 2) % 3; };
+  for (uint32_t h = 0; h < mate.size(); ++h) {
+    if (mate[h] < h) continue;
+    if (CGAL::orientation(points[vertexAt(h)], points[vertexAt(next(h))],
+                          points[vertexAt(prev(h))],
+                          points[vertexAt(prev(mate[h]))]) == CGAL::POSITIVE) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Quick approximation of convertObjectToNef() followed by decompose() and
+// hull_parts(), for interactive use while the exact pipeline runs: Nef
+// polyhedra need exact constructions, so no Nef is built. Instead, every
+// shell of the split soup stands in for a convex part and is hulled. All
+// predicates are exact (Epick), so each stage can tell whether its shortcut
+// matches the exact result; stages that can't guarantee it are flagged:
+// - nef_construction: open or inverted shells, faces that intersect or
+//   touch, or shells with overlapping bounding boxes, which the exact Nef may
+//   fill or union.
+// - convex_decomposition: non-convex shells, for which the hull is only an
+//   outer bound. Convex shells are exactly the parts the exact pipeline
+//   returns for them.
+// Runs in time linear in the input, apart from sorting and the intersection
+// test.
+inline Preview previewDecomposition(const Object &obj) {
+  namespace PMP = CGAL::Polygon_mesh_processing;
+  Preview preview;
+  auto timed = [&preview](const char *name, auto &&run) {
+    const auto start = std::chrono::steady_clock::now();
+    PreviewStage stage;
+    stage.name = name;
+    run(stage);
+    stage.ms = std::chrono::duration<double, std::milli>(
+                   std::chrono::steady_clock::now() - start)
+                   .count();
+    preview.stages.push_back(std::move(stage));
+  };
+  auto toEpick = [](const Object &o) {
+    std::vector<Epick_Point3> points;
+    points.reserve(o.vertices.size());
+    for (const auto &v : o.vertices) points.emplace_back(v[0], v[1], v[2]);
+    return points;
+  };
+
+  ManifoldStats stats;
+  std::vector<Object> shells;
+  timed("manifold_split", [&](PreviewStage &) {
+    shells = splitObjectShells(splitNonManifold(obj, &stats));
+  });
+
+  timed("nef_construction", [&](PreviewStage &stage) {
+    std::vector<std::string> issues;
+    if (!stats.closed) issues.push_back("open shells");
+    if (stats.inverted_shells > 0) {
+      issues.push_back(std::to_string(stats.inverted_shells) + " inverted shells");
+    }
+    // Shells are checked together: touching shells are unioned exactly.
+    Object all;
+    for (const auto &shell : shells) {
+      const uint32_t offset = all.vertices.size();
+      all.vertices.insert(all.vertices.end(), shell.vertices.begin(),
+                          shell.vertices.end());
+      for (const auto &f : shell.indices) {
+        all.indices.push_back({f[0] + offset, f[1] + offset, f[2] + offset});
+      }
+    }
+    if (PMP::does_triangle_soup_self_intersect(toEpick(all), all.indices)) {
+      issues.push_back("faces intersect or shells touch");
+    }
+    // Disjoint shells may still be nested; only boxes are compared.
+    std::vector<CGAL::Bbox_3> boxes;
+    for (const auto &shell : shells) {
+      CGAL::Bbox_3 &box = boxes.emplace_back();
+      for (const auto &v : shell.vertices) {
+        box += CGAL::Bbox_3(v[0], v[1], v[2], v[0], v[1], v[2]);
+      }
+    }
+    bool overlapping = false;
+    for (size_t i = 0; i < boxes.size() && !overlapping; ++i) {
+      for (size_t j = i + 1; j < boxes.size() && !overlapping; ++j) {
+        overlapping = CGAL::do_overlap(boxes[i], boxes[j]);
+      }
+    }
+    if (overlapping) issues.push_back("shell bounding boxes overlap");
+    stage.guaranteed = issues.empty();
+    for (const auto &issue : issues) {
+      stage.note += (stage.note.empty() ? "" : ", ") + issue;
+    }
+  });
+
+  std::vector<std::vector<Epick_Point3>> parts;
+  timed("convex_decomposition", [&](PreviewStage &stage) {
+    size_t non_convex = 0;
+    for (const auto &shell : shells) {
+      parts.push_back(toEpick(shell));
+      if (!isConvexShell(shell, parts.back())) non_convex++;
+    }
+    if (non_convex > 0) {
+      stage.guaranteed = false;
+      stage.note = std::to_string(non_convex) + " of " +
+                   std::to_string(shells.size()) +
+                   " shells not convex, hulled instead";
+    }
+  });
+
+  timed("hull", [&](PreviewStage &) {
+    for (const auto &part : parts) {
+      CGAL::convex_hull_3(part.begin(), part.end(), preview.hulls.emplace_back());
+    }
+  });
+  return preview;
+}
+
+inline void printPreview(const Preview &preview, std::ostream &out) {
+  double total_ms = 0;
+  for (const auto &stage : preview.stages) {
+    out << "  " << stage.name << ": " << stage.ms << " ms";
+    if (!stage.guaranteed) out << ", NOT GUARANTEED (" << stage.note << ")";
+    out << std::endl;
+    total_ms += stage.ms;
+  }
+  out << "  " << preview.hulls.size() << " parts in " << total_ms << " ms, "
+      << (preview.guaranteed() ? "same as the exact result"
+                               : "may differ from the exact result")
+      << std::endl;
+}
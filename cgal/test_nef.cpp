@@ -0,0 +1,222 @@
+/*
+
+Checks of cgal_tools.h behaviour that the tools and benchmarks would not
+notice, because a wrong answer there only costs time or silently changes the
+output. Prints one line per check and exits with status 1 if any failed.
+
+Usage: test_nef
+
+ */
+
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <type_traits>
+
+#include "cgal_tools.h"
+#include "nef_snapshot.h"
+#include "objects.h"
+
+int failures = 0;
+
+void check(bool ok, const std::string &what) {
+  std::cout << (ok ? "ok:     " : "FAILED: ") << what << std::endl;
+  if (!ok) failures++;
+}
+
+size_t stageCalls(const PipelineMetrics &metrics, const std::string &name) {
+  size_t calls = 0;
+  for (const auto &stage : metrics.stages()) {
+    if (stage.name == name) calls += stage.calls;
+  }
+  return calls;
+}
+
+// Decomposes nef and returns the number of parts. Sets convex_decomposition
+// to whether convex_decomposition_3() ran, i.e. the fast path was not taken.
+size_t decomposeCountingParts(CGAL_Nef_polyhedron3 &&nef,
+                              bool &convex_decomposition) {
+  PipelineMetrics metrics;
+  current_metrics = &metrics;
+  size_t num_parts = 0;
+  decompose_to_sink(std::move(nef),
+                    [&num_parts](std::vector<Double_Point3> &&) { num_parts++; });
+  current_metrics = nullptr;
+  convex_decomposition = stageCalls(metrics, "convex_decomposition") > 0;
+  return num_parts;
+}
+
+// isConvexNef() assumes convert_inner_shell_to_polyhedron() orients the
+// boundary outwards. If it didn't, convex input would take the slow path, and
+// non-convex input would be passed on as a single part.
+void testConvexFastPath() {
+  {
+    CGAL_Nef_polyhedron3 cube = convertObjectToNef(first_cube);
+    CGAL::Polyhedron_3<CGAL_Kernel3> P;
+    check(isConvexNef(cube, P), "isConvexNef() accepts a cube");
+    bool convex_decomposition = true;
+    const size_t num_parts =
+        decomposeCountingParts(std::move(cube), convex_decomposition);
+    check(num_parts == 1 && !convex_decomposition,
+          "a cube is passed on without convex_decomposition_3()");
+  }
+  {
+    CGAL_Nef_polyhedron3 l_shape =
+        convertObjectToNef(boxObject({0, 0, 0}, {2, 1, 1})) +
+        convertObjectToNef(boxObject({0, 0, 0}, {1, 2, 1}));
+    CGAL::Polyhedron_3<CGAL_Kernel3> P;
+    check(!isConvexNef(l_shape, P), "isConvexNef() rejects an L-shape");
+    bool convex_decomposition = false;
+    const size_t num_parts =
+        decomposeCountingParts(std::move(l_shape), convex_decomposition);
+    check(num_parts >= 2 && convex_decomposition,
+          "an L-shape goes through convex_decomposition_3()");
+  }
+}
+
+// A hollow cube's void shell is its own connected component, oriented
+// inwards. Built as a separate Nef and unioned, it would fill the cavity.
+void testHollowCubeByComponent() {
+  Object hollow = boxObject({0, 0, 0}, {3, 3, 3});
+  const Object cavity = boxObject({1, 1, 1}, {2, 2, 2});
+  const uint32_t offset = hollow.vertices.size();
+  hollow.vertices.insert(hollow.vertices.end(), cavity.vertices.begin(),
+                         cavity.vertices.end());
+  for (const auto &f : cavity.indices) {
+    hollow.indices.push_back({f[0] + offset, f[2] + offset, f[1] + offset});
+  }
+
+  ThreadPool pool;
+  const CGAL_Nef_polyhedron3 nef =
+      convertSurfaceMeshToNefByComponent(createSurfaceMesh(hollow), pool);
+  const CGAL_Nef_polyhedron3 expected =
+      convertObjectToNef(boxObject({0, 0, 0}, {3, 3, 3})) -
+      convertObjectToNef(cavity);
+  check(nef == expected && nef.number_of_volumes() == 3,
+        "per-component construction keeps a hollow cube's cavity");
+}
+
+// unionNefs() concatenates the SNCs of operands with disjoint bounding boxes
+// instead of overlaying them (nef_concat.h). The result must be the same Nef
+// as the overlay gives.
+void testDisjointUnion() {
+  std::vector<CGAL_Nef_polyhedron3> cubes;
+  for (const Object &cube : splitObjectShells(separate_cubes)) {
+    cubes.emplace_back(createSurfaceMesh(cube));
+  }
+  CGAL_Nef_polyhedron3 overlaid;
+  for (const auto &cube : cubes) overlaid += cube;
+
+  UnionStats stats;
+  const CGAL_Nef_polyhedron3 concatenated = unionNefs(cubes, &stats);
+  check(cubes.size() == 2 && stats.skipped_overlays > 0,
+        "unionNefs() skips the overlay of separate cubes");
+  check(concatenated.is_valid() && concatenated == overlaid,
+        "concatenated separate cubes equal their overlay");
+}
+
+// buildNefFromSoup() builds the SNC by hand, and convertObjectToNef() uses
+// it for every manifold fixture, so it is compared against CGAL's own
+// constructor here rather than against itself.
+void testSoupBuilder() {
+  // Unit cube without its top: an open shell, kept as a surface.
+  Object open_box = boxObject({0, 0, 0}, {1, 1, 1});
+  open_box.indices.erase(open_box.indices.begin() + 2,
+                         open_box.indices.begin() + 4);
+  const std::pair<const char *, Object> soups[] = {
+      {"first_cube", first_cube}, {"tetracyl", tetracyl}, {"open box", open_box}};
+  for (const auto &[name, soup] : soups) {
+    const auto built = buildNefFromSoup(soup);
+    const CGAL_Nef_polyhedron3 expected(createSurfaceMesh(soup));
+    check(built && built->is_valid() && *built == expected,
+          std::string("buildNefFromSoup() matches the Nef constructor on ") +
+              name);
+  }
+}
+
+// Summing the records without a parent must not count a stage twice, also
+// when the inner stage runs in a pool task.
+void testNestedStages() {
+  PipelineMetrics metrics;
+  current_metrics = &metrics;
+  ThreadPool pool(2);
+  {
+    ScopedStage outer("outer");
+    { ScopedStage inner("inner"); }
+    pool.parallel_for(2, [parent = current_stage](size_t) {
+      StageParent stage_parent(parent);
+      ScopedStage inner("inner");
+    });
+  }
+  current_metrics = nullptr;
+  const auto stages = metrics.stages();
+  check(stages.size() == 2 && stages[0].name == "inner" &&
+            stages[0].parent == "outer" && stages[0].calls == 3 &&
+            stages[1].name == "outer" && stages[1].parent.empty(),
+        "stages within a stage and its pool tasks are recorded with a parent");
+}
+
+// touching_cubes_14 is touching_cubes with the shared vertices merged by hand,
+// in the order weldVertices() keeps them.
+void testWeld() {
+  size_t num_merged = 0;
+  const Object welded = weldVertices(touching_cubes, 0, num_merged);
+  check(num_merged == 2 && welded.vertices == touching_cubes_14.vertices &&
+            welded.indices == touching_cubes_14.indices,
+        "welding touching_cubes with epsilon 0 yields touching_cubes_14");
+
+  const auto mesh = createSurfaceMesh(touching_cubes, 0.0, &num_merged);
+  check(num_merged == 2 && mesh.number_of_vertices() == 14,
+        "createSurfaceMesh() welds touching_cubes to 14 vertices");
+
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  const double inf = std::numeric_limits<double>::infinity();
+  const Object huge = {
+      .vertices = {{1e300, 0, nan}, {1e300, 0, nan}, {inf, 0, 0}, {1e300, 0, 0},
+                   {1e300, 0, 0}},
+      .indices = {},
+  };
+  const Object kept = weldVertices(huge, 1e-300, num_merged);
+  check(num_merged == 1 && kept.vertices.size() == 4,
+        "welding far outside the grid merges only identical finite vertices");
+}
+
+// The binary format and NefSnapshot both go through nef_records.h. Both need
+// Gmpq coordinates, so this only runs with such a kernel.
+template <typename Nef> void testRecordRoundTrips(const Nef &nef) {
+  if constexpr (std::is_same_v<typename Nef::Point_3::FT, CGAL::Gmpq>) {
+    const std::string filename = "test_nef.nef3b";
+    Nef read;
+    check(writeNefBinary(nef, filename) && readNefBinary(filename, read) &&
+              read.is_valid() && read == nef,
+          "a Nef survives writing and reading a .nef3b file");
+
+    std::ifstream in(filename, std::ios::binary | std::ios::ate);
+    std::string data(in.tellg(), '\0');
+    in.seekg(0);
+    in.read(&data[0], data.size());
+    in.close();
+    std::ofstream(filename, std::ios::binary).write(data.data(), data.size() / 2);
+    check(!readNefBinary(filename, read), "a truncated .nef3b file is rejected");
+
+    const Nef thawed = NefSnapshot<Nef>(nef).thaw();
+    check(thawed.is_valid() && thawed == nef,
+          "a Nef survives freezing and thawing a NefSnapshot");
+  }
+}
+
+int main() {
+  testNestedStages();
+  testConvexFastPath();
+  testHollowCubeByComponent();
+  testDisjointUnion();
+  testSoupBuilder();
+  testWeld();
+  testRecordRoundTrips(convertObjectToNef(touching_cubes));
+  if (failures > 0) {
+    std::cerr << failures << " checks failed" << std::endl;
+    return 1;
+  }
+  return 0;
+}
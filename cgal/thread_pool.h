@@ -0,0 +1,165 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Small persistent thread pool for the data-parallel loops in cgal_tools.h.
+// The calling thread takes part in every parallel_for(), so a pool with
+// num_threads == 1 owns no workers and runs everything inline.
+//
+// Scheduling is work-stealing: Every thread starts on its own contiguous
+// block of indices, and a thread that runs out steals the upper half of
+// another thread's remaining block. Neighbouring indices thus tend to stay on
+// one thread, while very uneven items (e.g. a few huge convex parts among
+// many tiny ones) still balance out.
+class ThreadPool {
+public:
+  explicit ThreadPool(unsigned int num_threads = std::thread::hardware_concurrency())
+      : num_threads_(std::max(1u, num_threads)), ranges_(num_threads_) {
+    for (unsigned int i = 1; i < num_threads_; ++i) {
+      workers_.emplace_back([this, i] { workerLoop(i); });
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    job_cv_.notify_all();
+    for (auto &worker : workers_) {
+      worker.join();
+    }
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  unsigned int size() const { return num_threads_; }
+
+  // Calls fn(i) for every i in [0, n). The first exception thrown by fn is
+  // rethrown here once all threads are done; remaining indices are skipped.
+  // Must not be called from within fn.
+  void parallel_for(size_t n, const std::function<void(size_t)> &fn) {
+    if (n == 0) return;
+    if (workers_.empty() || n == 1) {
+      for (size_t i = 0; i < n; ++i) fn(i);
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      job_ = &fn;
+      for (unsigned int t = 0; t < num_threads_; ++t) {
+        std::lock_guard<std::mutex> range_lock(ranges_[t].mutex);
+        ranges_[t].begin = n * t / num_threads_;
+        ranges_[t].end = n * (t + 1) / num_threads_;
+      }
+      cancelled_ = false;
+      active_workers_ = workers_.size();
+      error_ = nullptr;
+      ++generation_;
+    }
+    job_cv_.notify_all();
+
+    runJob(0, fn);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this] { return active_workers_ == 0; });
+    job_ = nullptr;
+    if (error_) {
+      std::rethrow_exception(error_);
+    }
+  }
+
+private:
+  struct Range {
+    std::mutex mutex;
+    size_t begin = 0;
+    size_t end = 0;
+  };
+
+  // Takes the next index from the own range, or steals from another thread.
+  bool nextIndex(unsigned int self, size_t &index) {
+    if (cancelled_) return false;
+    {
+      Range &own = ranges_[self];
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if (own.begin < own.end) {
+        index = own.begin++;
+        return true;
+      }
+    }
+    for (unsigned int k = 1; k < num_threads_; ++k) {
+      Range &victim = ranges_[(self + k) % num_threads_];
+      size_t stolen_begin, stolen_end;
+      {
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.begin >= victim.end) continue;
+        stolen_begin = victim.begin + (victim.end - victim.begin) / 2;
+        stolen_end = victim.end;
+        victim.end = stolen_begin;
+      }
+      index = stolen_begin;
+      Range &own = ranges_[self];
+      std::lock_guard<std::mutex> lock(own.mutex);
+      own.begin = stolen_begin + 1;
+      own.end = stolen_end;
+      return true;
+    }
+    return false;
+  }
+
+  void runJob(unsigned int self, const std::function<void(size_t)> &fn) {
+    size_t i;
+    while (nextIndex(self, i)) {
+      try {
+        fn(i);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!error_) error_ = std::current_exception();
+        cancelled_ = true;
+      }
+    }
+  }
+
+  void workerLoop(unsigned int self) {
+    size_t seen_generation = 0;
+    while (true) {
+      const std::function<void(size_t)> *job;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        job_cv_.wait(lock, [&] { return stop_ || generation_ != seen_generation; });
+        if (stop_) return;
+        seen_generation = generation_;
+        job = job_;
+      }
+      runJob(self, *job);
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        --active_workers_;
+      }
+      done_cv_.notify_one();
+    }
+  }
+
+  unsigned int num_threads_;
+  std::vector<Range> ranges_;
+  std::vector<std::thread> workers_;
+
+  std::mutex mutex_;
+  std::condition_variable job_cv_;
+  std::condition_variable done_cv_;
+  const std::function<void(size_t)> *job_ = nullptr;
+  size_t generation_ = 0;
+  size_t active_workers_ = 0;
+  std::atomic<bool> cancelled_{false};
+  std::exception_ptr error_;
+  bool stop_ = false;
+};